@@ -1,4 +1,7 @@
 #include "src/StepperController.h"
+#include "src/MoveExecutor.h"
+#include "src/SessionJournal.h"
+#include <algorithm>
 #include <vector>
 #include <string>
 
@@ -18,6 +21,36 @@ bool getCmdOption(const std::vector<std::string>& args, const std::string& optio
     return false;
 }
 
+// Overload for options taking a path or a name
+bool getCmdOption(const std::vector<std::string>& args, const std::string& option, std::string& value) {
+    auto iter = std::find(args.begin(), args.end(), option);
+    if (iter != args.end() && ++iter != args.end()) {
+        value = *iter;
+        return true;
+    }
+    return false;
+}
+
+// Re-drives a controller from a journal written with --record and reports whether it behaved the same
+int replay_session(const std::string& path, bool original_speed) {
+    JournalReplayer replayer(path);
+    if (!replayer.isOpen()) {
+        return 1;
+    }
+    JournalReplayResult result = replayer.replay(original_speed);
+    Logger::instance().flush();
+    std::cout << "Replayed " << result.moves << " moves, " << result.ticks << " ticks in "
+              << std::chrono::duration<double>(result.replay_duration).count() << " s (recorded session: "
+              << std::chrono::duration<double>(result.recorded_duration).count() << " s)\n";
+    if (result.mismatches > 0) {
+        std::cout << result.mismatches << " records differ from the recording, the first one is record "
+                  << result.first_mismatch << "\n";
+        return 1;
+    }
+    std::cout << "The replay matches the recording bit for bit\n";
+    return 0;
+}
+
 int main(int argc, char* argv[])
 {
     // Define command line options
@@ -27,12 +60,22 @@ int main(int argc, char* argv[])
     int max_vel = 0;
     int max_acc = 0;
     bool show_help = false;
+    bool shm_telemetry = false;
+    std::string record_path;
+    std::string replay_path;
 
     // Parse command line arguments
     std::vector<std::string> args(argv + 1, argv + argc);
+    bool original_speed = std::find(args.begin(), args.end(), "--original-speed") != args.end();
+    if (getCmdOption(args, "--replay", replay_path)) {
+        return replay_session(replay_path, original_speed);
+    }
+    getCmdOption(args, "--record", record_path);
     for (const auto& arg : args) {
         if (arg == "-h" || arg == "--help") {
             show_help = true;
+        } else if (arg == "--shm-telemetry") {
+            shm_telemetry = true;
         } else if (!getCmdOption(args, "--initial-pos", initial_pos) ||
                    !getCmdOption(args, "--initial-vel", initial_vel) ||
                    !getCmdOption(args, "--goal-pos", goal_pos) ||
@@ -45,17 +88,43 @@ int main(int argc, char* argv[])
 
     // Print help message and exit if requested or if command line arguments are invalid
     if (show_help) {
-        std::cout << "Usage: " << argv[0] << " [--initial-pos <int>] [--initial-vel <int>] [--goal-pos <int>] [--max-vel <int>] [--max-acc <int>]\n";
+        std::cout << "Usage: " << argv[0] << " [--initial-pos <int>] [--initial-vel <int>] [--goal-pos <int>] [--max-vel <int>] [--max-acc <int>] [--shm-telemetry] [--record <journal>]\n"
+                  << "       " << argv[0] << " --replay <journal> [--original-speed]\n";
         return 0;
     }
 
-    // Set up stepper controller and perform motor movement
-    StepperController controller(initial_pos, initial_vel, goal_pos, max_vel, max_acc);
-    controller.step();
+    // Set up stepper controller and perform motor movement. With --shm-telemetry the samples go to shared memory
+    // instead of the socket, and the move is paced in real time by the executor rather than by send_data
+    std::unique_ptr<StepperController> controller;
+    if (shm_telemetry) {
+        controller.reset(new StepperController(initial_pos, initial_vel));
+        controller->set_goal(goal_pos, max_vel, max_acc);
+        controller->setSharedMemoryTelemetryName("stepper_telemetry");
+    } else {
+        controller.reset(new StepperController(initial_pos, initial_vel, goal_pos, max_vel, max_acc));
+    }
+    // Every run is also appended to the archive so earlier runs can still be plotted with --run
+    controller->setArchivePath("../data/trajectories.smta");
+    // With --record every call made to the controller goes through the journal, see --replay
+    std::unique_ptr<JournalingController> journal;
+    MotorController* motor = controller.get();
+    if (!record_path.empty()) {
+        journal.reset(new JournalingController(*controller, record_path));
+        motor = journal.get();
+    }
+    if (shm_telemetry) {
+        MoveExecutor executor(1, std::chrono::microseconds(static_cast<long>(controller->getTimeStep() * 1e6)));
+        executor.submit(*motor).wait();
+    } else {
+        motor->step();
+    }
+    journal.reset();
+    // The log is written in the background, get it out before the plot takes over the terminal
+    Logger::instance().flush();
 
     // Graph position over time if everything looks good. This prevents the last successful plot from being displayed
     // as the csv file hasn't been overwritten yet
-    bool sanity_check_flag = controller.isSanityCheckFlag();
+    bool sanity_check_flag = controller->isSanityCheckFlag();
     if(sanity_check_flag) {
         system("python3 ../scripts/plot_trajectory.py");
     }
@@ -1,17 +1,164 @@
 #!/usr/bin/env python3
 
-import matplotlib.pyplot as plt
+import argparse
 import csv
+import zlib
 from pathlib import Path
 
+import matplotlib.pyplot as plt
+import numpy as np
+
+# Must match TrajectoryArchiveHeader / TrajectoryRunHeader in src/TrajectoryArchive.h
+ARCHIVE_HEADER_DTYPE = np.dtype([
+    ('magic', 'S4'),
+    ('version', '<u4'),
+    ('header_size', '<u4'),
+    ('reserved0', '<u4'),
+    ('run_count', '<u8'),
+    ('end_offset', '<u8'),
+    ('last_run_offset', '<u8'),
+    ('reserved', '<u4', (6,)),
+])
+ARCHIVE_HEADER_SIZE = ARCHIVE_HEADER_DTYPE.itemsize
+RUN_COMPRESSED = 1
+RUN_HEADER_DTYPE = np.dtype([
+    ('magic', 'S4'),
+    ('run_id', '<u4'),
+    ('sample_count', '<u8'),
+    ('column_count', '<u4'),
+    ('flags', '<u4'),
+    ('chunk_size', '<u8'),
+    ('unix_time_ns', '<i8'),
+    ('initial_position', '<f4'),
+    ('initial_velocity', '<f4'),
+    ('goal_position', '<f4'),
+    ('max_velocity', '<f4'),
+    ('max_acceleration', '<f4'),
+    ('time_step', '<f4'),
+    ('column_offset', '<u8', (4,)),
+    ('column_bytes', '<u8', (4,)),
+])
 
-def plot_motion_profile(csv_path):
+
+def is_run_valid(header, available):
     '''
-    This function plots the values from a csv file with time_steps, position, velocity and acceleration.
-    It plots two graphs. One with 3 subplots and the other with all three curves superimposed on each other
-    :param csv_path: path to the trajectories.csv file
+    Checks that a run header describes columns lying entirely within its own chunk, like
+    TrajectoryArchiveReader::isRunValid
+    :param header: the run header
+    :param available: bytes from the start of the run header to the end of the archive
+    :return: True if the run can be read safely
+    '''
+    chunk_size = int(header['chunk_size'])
+    sample_count = int(header['sample_count'])
+    if header['magic'] != b'RUN0' or chunk_size < RUN_HEADER_DTYPE.itemsize or chunk_size > available or \
+            int(header['column_count']) != 4 or sample_count > chunk_size // 4:
+        return False
+    for column in range(4):
+        offset = int(header['column_offset'][column])
+        size = int(header['column_bytes'][column])
+        if offset < RUN_HEADER_DTYPE.itemsize or offset % 4 or offset + size > chunk_size:
+            return False
+        if not header['flags'] & RUN_COMPRESSED and size != sample_count * 4:
+            return False
+    return True
+
+
+def read_archive_header(archive):
+    '''
+    :param archive: the archive mapped with np.memmap(dtype=np.uint8)
+    :return: the archive header
+    '''
+    if archive.size < ARCHIVE_HEADER_SIZE or bytes(archive[:4]) != b'SMTA':
+        raise ValueError('not a trajectory archive')
+    return archive[:ARCHIVE_HEADER_SIZE].view(ARCHIVE_HEADER_DTYPE)[0]
+
+
+def archive_end(archive):
+    '''
+    :param archive: the archive mapped with np.memmap(dtype=np.uint8)
+    :return: the end of the newest complete run, runs past it are still being written
+    '''
+    return min(int(read_archive_header(archive)['end_offset']), archive.size)
+
+
+def index_archive(archive):
+    '''
+    Walks the run headers of a memory mapped trajectory archive.
+    :param archive: the archive mapped with np.memmap(dtype=np.uint8)
+    :return: list of (offset, header) tuples, one per complete run, oldest first. Indexing stops at the first
+    partially written or corrupted run.
+    '''
+    end = archive_end(archive)
+    runs = []
+    offset = ARCHIVE_HEADER_SIZE
+    while offset + RUN_HEADER_DTYPE.itemsize <= end:
+        header = archive[offset:offset + RUN_HEADER_DTYPE.itemsize].view(RUN_HEADER_DTYPE)[0]
+        if not is_run_valid(header, end - offset):
+            break
+        runs.append((offset, header))
+        offset += int(header['chunk_size'])
+    return runs
+
+
+def locate_archive_run(archive, run):
+    '''
+    Finds a run of a trajectory archive. The newest run is found straight from the archive header, other runs by
+    walking the run headers.
+    :param archive: the archive mapped with np.memmap(dtype=np.uint8)
+    :param run: index of the run, negative values count from the newest run
+    :return: (offset, header) of the run
+    '''
+    archive_header = read_archive_header(archive)
+    end = archive_end(archive)
+    offset = int(archive_header['last_run_offset'])
+    if run == -1 and int(archive_header['run_count']) > 0 and ARCHIVE_HEADER_SIZE <= offset and \
+            offset + RUN_HEADER_DTYPE.itemsize <= end:
+        header = archive[offset:offset + RUN_HEADER_DTYPE.itemsize].view(RUN_HEADER_DTYPE)[0]
+        if is_run_valid(header, end - offset):
+            return offset, header
+    return index_archive(archive)[run]
+
+
+def read_archive_run(archive_path, run):
+    '''
+    Reads one run of a trajectory archive. Uncompressed columns are views into the mapped file, nothing is parsed.
+    :param archive_path: path to the trajectories.smta file
+    :param run: index of the run, negative values count from the newest run
+    :return: time, position, velocity and acceleration arrays
+    '''
+    archive = np.memmap(archive_path, dtype=np.uint8, mode='r')
+    offset, header = locate_archive_run(archive, run)
+    count = int(header['sample_count'])
+    columns = []
+    for column in range(4):
+        start = offset + int(header['column_offset'][column])
+        stored = archive[start:start + int(header['column_bytes'][column])]
+        if header['flags'] & RUN_COMPRESSED:
+            columns.append(np.frombuffer(zlib.decompress(stored.tobytes()), dtype='<f4', count=count))
+        else:
+            columns.append(stored.view('<f4')[:count])
+    return columns
+
+
+def list_archive_runs(archive_path):
+    '''
+    Prints one line per run stored in a trajectory archive
+    :param archive_path: path to the trajectories.smta file
     :return:
     '''
+    archive = np.memmap(archive_path, dtype=np.uint8, mode='r')
+    for index, (_, header) in enumerate(index_archive(archive)):
+        print(f"{index}: {int(header['sample_count'])} samples, "
+              f"{header['initial_position']:g} -> {header['goal_position']:g}, "
+              f"max vel {header['max_velocity']:g}, max acc {header['max_acceleration']:g}")
+
+
+def read_csv(csv_path):
+    '''
+    Reads the time_steps, position, velocity and acceleration columns of a trajectories.csv file
+    :param csv_path: path to the trajectories.csv file
+    :return: time, position, velocity and acceleration lists
+    '''
     # Initialize lists for time, position, velocity, and acceleration
     time = []
     position = []
@@ -26,7 +173,40 @@ def plot_motion_profile(csv_path):
             position.append(float(row[1]))
             velocity.append(float(row[2]))
             acceleration.append(float(row[3]))
+    return time, position, velocity, acceleration
+
+
+def reconstruct_trajectory(time, position, velocity, acceleration, time_step):
+    '''
+    Rebuilds a uniformly sampled trajectory from any samples, in particular adaptively sampled ones. Each sample holds
+    its acceleration until the next one, so the position at t is s + v*dt + 0.5*a*dt^2 from the last sample before t.
+    :param time: the sample times, increasing
+    :param position: the position at each sample
+    :param velocity: the velocity at each sample
+    :param acceleration: the acceleration applied from each sample to the next one
+    :param time_step: spacing of the rebuilt samples
+    :return: time, position, velocity and acceleration arrays, sampled every time_step plus the last sample
+    '''
+    time, position, velocity, acceleration = (np.asarray(column, dtype=np.float64) for column in
+                                              (time, position, velocity, acceleration))
+    dense_time = np.append(np.arange(time[0], time[-1], time_step), time[-1])
+    index = np.clip(np.searchsorted(time, dense_time, side='right') - 1, 0, len(time) - 1)
+    dt = dense_time - time[index]
+    dense_position = position[index] + velocity[index] * dt + 0.5 * acceleration[index] * dt ** 2
+    dense_velocity = velocity[index] + acceleration[index] * dt
+    return dense_time, dense_position, dense_velocity, acceleration[index]
+
 
+def plot_motion_profile(time, position, velocity, acceleration):
+    '''
+    This function plots the time_steps, position, velocity and acceleration of a trajectory.
+    It plots two graphs. One with 3 subplots and the other with all three curves superimposed on each other
+    :param time: the time steps
+    :param position: the position at each time step
+    :param velocity: the velocity at each time step
+    :param acceleration: the acceleration at each time step
+    :return:
+    '''
     # Create a single subplot for position, velocity, and acceleration
     fig_all, ax = plt.subplots(nrows=1, ncols=1, figsize=(12, 4))
     fig, (ax1, ax2, ax3) = plt.subplots(nrows=1, ncols=3, figsize=(12, 4))
@@ -62,8 +242,24 @@ def plot_motion_profile(csv_path):
 
 
 def main():
-    csv_path = Path('../data/trajectories.csv')
-    plot_motion_profile(csv_path)
+    parser = argparse.ArgumentParser(description='Plot a stepper motor trajectory')
+    parser.add_argument('--archive', type=Path, default=Path('../data/trajectories.smta'),
+                        help='trajectory archive to read runs from')
+    parser.add_argument('--csv', type=Path, default=Path('../data/trajectories.csv'),
+                        help='csv file to fall back on when there is no archive')
+    parser.add_argument('--run', type=int, default=-1, help='run to plot, negative values count from the newest')
+    parser.add_argument('--list', action='store_true', help='list the runs in the archive and exit')
+    parser.add_argument('--reconstruct', type=float, metavar='TIME_STEP',
+                        help='resample the trajectory every TIME_STEP seconds, e.g. for adaptively sampled runs')
+    args = parser.parse_args()
+
+    if args.list and args.archive.exists():
+        list_archive_runs(args.archive)
+        return
+    trajectory = read_archive_run(args.archive, args.run) if args.archive.exists() else read_csv(args.csv)
+    if args.reconstruct:
+        trajectory = reconstruct_trajectory(*trajectory, args.reconstruct)
+    plot_motion_profile(*trajectory)
 
 
 if __name__ == '__main__':
@@ -0,0 +1,116 @@
+#!/usr/bin/env python3
+import argparse
+import mmap
+import struct
+import time
+from pathlib import Path
+
+# Must match TelemetryRingHeader / TelemetryRingSlot in src/SharedMemoryTelemetry.h
+HEADER = struct.Struct('<4sIIIQQ32x')
+SLOT = struct.Struct('<Q4f8x')
+RING_VERSION = 1
+
+
+class SharedMemoryTelemetryReader:
+    '''
+    Follows the telemetry ring a StepperController publishes to /dev/shm/<name> with setSharedMemoryTelemetryName().
+    Reading never blocks the controller: every slot carries a sequence number that is odd while the controller writes
+    it, so a sample is only kept if its sequence is the expected one before and after copying it.
+    '''
+
+    def __init__(self, name='stepper_telemetry'):
+        '''
+        Maps the shared memory object read-only
+        :param name: name of the shared memory object, as passed to the controller
+        '''
+        self.path = Path('/dev/shm') / name.lstrip('/')
+        self.map()
+
+    def map(self):
+        '''
+        Maps the ring and copies its capacity and generation, slots are always indexed against this mapping
+        '''
+        with self.path.open('rb') as shm_file:
+            self.buffer = mmap.mmap(shm_file.fileno(), 0, access=mmap.ACCESS_READ)
+        magic, version, self.capacity, slot_size, _, self.generation = HEADER.unpack_from(self.buffer, 0)
+        if magic != b'SMTR' or version != RING_VERSION or slot_size != SLOT.size or self.capacity == 0 or \
+                HEADER.size + self.capacity * SLOT.size > len(self.buffer):
+            raise ValueError(f'{self.path} is not a stepper telemetry ring')
+        self.cursor = 0
+
+    def reopen_if_replaced(self):
+        '''
+        A new publisher creates a new ring under the same name and bumps the generation of the old one, open the name
+        again and start over. The old ring is never resized, so the current mapping stays valid until then.
+        '''
+        if HEADER.unpack_from(self.buffer, 0)[5] != self.generation:
+            self.buffer.close()
+            self.map()
+
+    def write_count(self):
+        '''
+        :return: the number of samples published so far
+        '''
+        return HEADER.unpack_from(self.buffer, 0)[4]
+
+    def read_sample(self, index):
+        '''
+        Copies sample number index out of the ring
+        :param index: index of the sample since the controller started publishing
+        :return: (time, position, velocity, acceleration), or None if the sample is not there (anymore)
+        '''
+        offset = HEADER.size + (index % self.capacity) * SLOT.size
+        expected = 2 * index + 2
+        sequence, *sample = SLOT.unpack_from(self.buffer, offset)
+        if sequence != expected or SLOT.unpack_from(self.buffer, offset)[0] != expected:
+            return None
+        return tuple(sample)
+
+    def read_latest(self):
+        '''
+        :return: the most recently published (time, position, velocity, acceleration), or None if there is none yet
+        '''
+        self.reopen_if_replaced()
+        while True:
+            write_count = self.write_count()
+            if write_count == 0:
+                return None
+            sample = self.read_sample(write_count - 1)
+            if sample is not None:
+                return sample
+
+    def read_new(self):
+        '''
+        Returns every sample published since the previous call. Samples overwritten before they could be read are
+        skipped, a restarted controller is followed from its first sample.
+        :return: list of (time, position, velocity, acceleration)
+        '''
+        self.reopen_if_replaced()
+        write_count = self.write_count()
+        if self.cursor > write_count:
+            self.cursor = 0
+        self.cursor = max(self.cursor, write_count - self.capacity)
+        samples = []
+        while self.cursor < write_count:
+            sample = self.read_sample(self.cursor)
+            if sample is not None:
+                samples.append(sample)
+            self.cursor += 1
+        return samples
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Print the telemetry a controller publishes to shared memory')
+    parser.add_argument('--name', default='stepper_telemetry', help='name of the shared memory object')
+    parser.add_argument('--interval', type=float, default=0.05, help='polling interval in seconds')
+    args = parser.parse_args()
+
+    reader = SharedMemoryTelemetryReader(args.name)
+    while True:
+        for time_elapsed, position, velocity, acceleration in reader.read_new():
+            print(f"{time_elapsed:.3f},{position:.3f},{velocity:.3f},{acceleration:.3f}")
+        time.sleep(args.interval)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,183 @@
+//
+// Created by chu-chu on 10/19/26.
+//
+
+#ifndef URBAN_MACHINE_GENERIC_STEPPER_MOTOR_CONTROLLER_CONTROLLERBATCH_H
+#define URBAN_MACHINE_GENERIC_STEPPER_MOTOR_CONTROLLER_CONTROLLERBATCH_H
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "MotorController.h"
+
+
+// Drives many axes of a fixed set of concrete controller types. The batch owns its controllers: emplace() constructs
+// each one in place, next to the previous axis of the same type, in chunks that never move so the returned reference
+// stays valid for the life of the batch. Every group is ticked in a tight loop through qualified Controller::tick()
+// calls, bound at compile time, so ticking N axes costs no virtual call and walks each type's axes in address order
+// instead of chasing a pointer per axis.
+//
+//     ControllerBatch<StepperController, OtherDriver> batch;
+//     StepperController &x_axis = batch.emplace<StepperController>(0, 0);
+//     x_axis.set_goal(100, 10, 1);
+//     batch.step_all();
+template<typename... Controllers>
+class ControllerBatch {
+    static_assert(sizeof...(Controllers) > 0, "ControllerBatch needs at least one controller type");
+    static_assert((std::is_base_of<MotorController, Controllers>::value and ...),
+                  "ControllerBatch only holds MotorController implementations");
+
+public:
+    ControllerBatch() = default;
+
+    ControllerBatch(const ControllerBatch &) = delete;
+
+    ControllerBatch &operator=(const ControllerBatch &) = delete;
+
+    /// @brief Constructs a controller of one of the batch's types at the end of its group
+    /// @param arguments the arguments of the controller's constructor
+    /// @return the new controller, it lives as long as the batch
+    template<typename Controller, typename... Arguments>
+    Controller &emplace(Arguments &&... arguments) {
+        static_assert((std::is_same<Controller, Controllers>::value or ...),
+                      "emplace() only takes one of the batch's controller types");
+        return std::get<Group<Controller>>(_groups).emplace(std::forward<Arguments>(arguments)...).controller;
+    }
+
+    size_t size() const {
+        return (std::get<Group<Controllers>>(_groups).size() + ...);
+    }
+
+    /// @brief Calls begin_move() on every axis
+    /// @return the number of axes whose move passed the sanity checks and started
+    size_t begin_all() {
+        return (begin_group(std::get<Group<Controllers>>(_groups)) + ...);
+    }
+
+    /// @brief Ticks every moving axis once. Axes whose move ends during this tick get finish_move() called.
+    /// @return the number of axes still moving
+    size_t tick_all() {
+        return (tick_group(std::get<Group<Controllers>>(_groups)) + ...);
+    }
+
+    /// @brief Asks every moving axis to decelerate to a stop
+    void request_stop_all() {
+        (stop_group(std::get<Group<Controllers>>(_groups)), ...);
+    }
+
+    /// @brief Runs one move on every axis in lock step, the batch equivalent of MotorController::step()
+    void step_all() {
+        begin_all();
+        while (tick_all() > 0) {
+        }
+    }
+
+private:
+    template<typename Controller>
+    struct Axis {
+        Controller controller;
+        bool moving;
+
+        template<typename... Arguments>
+        explicit Axis(Arguments &&... arguments) :
+                controller(std::forward<Arguments>(arguments)...),
+                moving(false) {}
+    };
+
+    // Axes of one type, stored by value in fixed size chunks. Controllers need not be movable since a chunk is never
+    // reallocated, only new chunks are added.
+    template<typename Controller>
+    class Group {
+    public:
+        static const size_t CHUNK_SIZE = 64;
+
+        Group() :
+                _size(0) {}
+
+        ~Group() {
+            for (size_t i = 0; i < _size; ++i) {
+                (*this)[i].~Axis<Controller>();
+            }
+        }
+
+        Group(const Group &) = delete;
+
+        Group &operator=(const Group &) = delete;
+
+        template<typename... Arguments>
+        Axis<Controller> &emplace(Arguments &&... arguments) {
+            if (_size % CHUNK_SIZE == 0) {
+                _chunks.emplace_back(new Storage[CHUNK_SIZE]);
+            }
+            Axis<Controller> *axis = new(&_chunks.back()[_size % CHUNK_SIZE])
+                    Axis<Controller>(std::forward<Arguments>(arguments)...);
+            ++_size;
+            return *axis;
+        }
+
+        size_t size() const {
+            return _size;
+        }
+
+        Axis<Controller> &operator[](size_t index) {
+            Storage &storage = _chunks[index / CHUNK_SIZE][index % CHUNK_SIZE];
+            return *std::launder(reinterpret_cast<Axis<Controller> *>(&storage));
+        }
+
+    private:
+        using Storage = typename std::aligned_storage<sizeof(Axis<Controller>), alignof(Axis<Controller>)>::type;
+
+        std::vector<std::unique_ptr<Storage[]>> _chunks;
+        size_t _size;
+    };
+
+    std::tuple<Group<Controllers>...> _groups;
+
+    template<typename Controller>
+    static size_t begin_group(Group<Controller> &group) {
+        size_t started = 0;
+        for (size_t i = 0; i < group.size(); ++i) {
+            Axis<Controller> &axis = group[i];
+            axis.moving = axis.controller.Controller::begin_move();
+            started += axis.moving;
+        }
+        return started;
+    }
+
+    template<typename Controller>
+    static size_t tick_group(Group<Controller> &group) {
+        size_t moving = 0;
+        for (size_t i = 0; i < group.size(); ++i) {
+            Axis<Controller> &axis = group[i];
+            if (!axis.moving) {
+                continue;
+            }
+            if (axis.controller.Controller::tick()) {
+                ++moving;
+            }
+            else {
+                axis.controller.Controller::finish_move();
+                axis.moving = false;
+            }
+        }
+        return moving;
+    }
+
+    template<typename Controller>
+    static void stop_group(Group<Controller> &group) {
+        for (size_t i = 0; i < group.size(); ++i) {
+            Axis<Controller> &axis = group[i];
+            if (axis.moving) {
+                axis.controller.Controller::request_stop();
+            }
+        }
+    }
+};
+
+
+#endif //URBAN_MACHINE_GENERIC_STEPPER_MOTOR_CONTROLLER_CONTROLLERBATCH_H
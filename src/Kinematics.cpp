@@ -0,0 +1,365 @@
+//
+// Created by chu-chu on 10/19/26.
+//
+
+#include "Kinematics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+    // Number of pieces a path of the given length is split into so that none is longer than segment_length
+    size_t segment_count(double length, float segment_length) {
+        if (!(segment_length > 0) or !(length > segment_length)) {
+            return 1;
+        }
+        return static_cast<size_t>(std::ceil(length / segment_length));
+    }
+
+}
+
+/// @brief Appends a tool position to every column
+void ToolpathColumns::append(const CartesianPoint &point) {
+    x.push_back(point.x);
+    y.push_back(point.y);
+    z.push_back(point.z);
+}
+
+/// @brief Removes every tool position, keeping the allocated memory
+void ToolpathColumns::clear() {
+    x.clear();
+    y.clear();
+    z.clear();
+}
+
+/// @brief Returns the number of tool positions
+size_t ToolpathColumns::size() const {
+    return x.size();
+}
+
+/// @brief Returns tool position number index
+CartesianPoint ToolpathColumns::point(size_t index) const {
+    return {x[index], y[index], z[index]};
+}
+
+/// @brief Returns the number of positions per motor
+size_t MotorColumns::size() const {
+    return motor.empty() ? 0 : motor[0].size();
+}
+
+
+size_t CartesianKinematics::getMotorCount() const {
+    return 3;
+}
+
+bool CartesianKinematics::isLinear() const {
+    return true;
+}
+
+/// @brief Computes the motor positions of a tool position
+/// @param point the tool position
+/// @param motor_positions where the getMotorCount() motor positions are written
+/// @return true, every position is reachable
+bool CartesianKinematics::inverse(const CartesianPoint &point, float *motor_positions) const {
+    motor_positions[0] = point.x;
+    motor_positions[1] = point.y;
+    motor_positions[2] = point.z;
+    return true;
+}
+
+/// @brief Computes the motor positions of count tool positions
+/// @param x, y, z the tool position columns
+/// @param count the number of tool positions
+/// @param motor_positions one column of count positions per motor
+/// @return true, every position is reachable
+bool CartesianKinematics::inverse_batch(const float *x, const float *y, const float *z, size_t count,
+                                        float *const *motor_positions) const {
+    std::copy(x, x + count, motor_positions[0]);
+    std::copy(y, y + count, motor_positions[1]);
+    std::copy(z, z + count, motor_positions[2]);
+    return true;
+}
+
+
+size_t CoreXYKinematics::getMotorCount() const {
+    return 3;
+}
+
+bool CoreXYKinematics::isLinear() const {
+    return true;
+}
+
+/// @brief Computes the motor positions of a tool position
+/// @param point the tool position
+/// @param motor_positions where the A, B and Z motor positions are written
+/// @return true, every position is reachable
+bool CoreXYKinematics::inverse(const CartesianPoint &point, float *motor_positions) const {
+    motor_positions[0] = point.x + point.y;
+    motor_positions[1] = point.x - point.y;
+    motor_positions[2] = point.z;
+    return true;
+}
+
+/// @brief Computes the motor positions of count tool positions
+/// @param x, y, z the tool position columns
+/// @param count the number of tool positions
+/// @param motor_positions the A, B and Z columns, count positions each
+/// @return true, every position is reachable
+bool CoreXYKinematics::inverse_batch(const float *x, const float *y, const float *z, size_t count,
+                                     float *const *motor_positions) const {
+    float *a = motor_positions[0];
+    float *b = motor_positions[1];
+    for (size_t i = 0; i < count; ++i) {
+        a[i] = x[i] + y[i];
+        b[i] = x[i] - y[i];
+    }
+    std::copy(z, z + count, motor_positions[2]);
+    return true;
+}
+
+
+/// @brief Constructor for DeltaKinematics class
+/// @param arm_length length of the arms between the carriages and the effector
+/// @param tower_radius horizontal distance between the Z axis and each tower, minus the effector offset
+DeltaKinematics::DeltaKinematics(float arm_length, float tower_radius) :
+        _arm_length_squared(arm_length * arm_length) {
+    for (int tower = 0; tower < 3; ++tower) {
+        double angle = M_PI / 2 + tower * 2 * M_PI / 3;
+        _tower_x[tower] = static_cast<float>(tower_radius * std::cos(angle));
+        _tower_y[tower] = static_cast<float>(tower_radius * std::sin(angle));
+    }
+}
+
+size_t DeltaKinematics::getMotorCount() const {
+    return 3;
+}
+
+bool DeltaKinematics::isLinear() const {
+    return false;
+}
+
+/// @brief Computes the carriage heights of a tool position
+/// @param point the tool position
+/// @param motor_positions where the three carriage heights are written
+/// @return false if an arm is too short to reach the position
+bool DeltaKinematics::inverse(const CartesianPoint &point, float *motor_positions) const {
+    for (int tower = 0; tower < 3; ++tower) {
+        float dx = _tower_x[tower] - point.x;
+        float dy = _tower_y[tower] - point.y;
+        float radicand = _arm_length_squared - dx * dx - dy * dy;
+        if (radicand < 0) {
+            Logger::instance().log(LOG_ERROR, LOG_FORMAT_POINT_UNREACHABLE, point.x, point.y, point.z);
+            return false;
+        }
+        motor_positions[tower] = point.z + std::sqrt(radicand);
+    }
+    return true;
+}
+
+/// @brief Computes the carriage heights of count tool positions. Every tower is a single loop without branches that
+/// the compiler vectorizes: unreachable positions are counted through a mask and get the height of a radicand of 0,
+/// and only if there are some does a separate pass find and log the first one.
+/// @param x, y, z the tool position columns
+/// @param count the number of tool positions
+/// @param motor_positions one column of count carriage heights per tower
+/// @return false if an arm is too short to reach one of the positions
+bool DeltaKinematics::inverse_batch(const float *x, const float *y, const float *z, size_t count,
+                                    float *const *motor_positions) const {
+    const float arm_length_squared = _arm_length_squared;
+    size_t unreachable = 0;
+    for (int tower = 0; tower < 3; ++tower) {
+        const float tower_x = _tower_x[tower];
+        const float tower_y = _tower_y[tower];
+        float *height = motor_positions[tower];
+        for (size_t i = 0; i < count; ++i) {
+            float dx = tower_x - x[i];
+            float dy = tower_y - y[i];
+            float radicand = arm_length_squared - dx * dx - dy * dy;
+            unreachable += radicand < 0;
+            height[i] = z[i] + std::sqrt(radicand < 0 ? 0.0f : radicand);
+        }
+    }
+    if (unreachable > 0) {
+        // Only pay for finding the culprit when there is one
+        float heights[3];
+        for (size_t i = 0; i < count; ++i) {
+            if (!inverse({x[i], y[i], z[i]}, heights)) {
+                break;
+            }
+        }
+        return false;
+    }
+    return true;
+}
+
+
+/// @brief Constructor for KinematicsPlanner class
+/// @param transform the machine's kinematics, it must outlive the planner
+/// @param start the tool position the path starts from
+KinematicsPlanner::KinematicsPlanner(const KinematicTransform &transform, const CartesianPoint &start) :
+        _transform(transform),
+        _segment_length(1.0f) {
+    _toolpath.append(start);
+}
+
+/// @brief Adds a straight move to the path. It is split into segments when the kinematics are not linear, so the
+/// motors, which move in straight lines between path points, keep the tool close to the line.
+/// @param end the tool position at the end of the line
+void KinematicsPlanner::line_to(const CartesianPoint &end) {
+    CartesianPoint start = _toolpath.point(_toolpath.size() - 1);
+    size_t pieces = 1;
+    if (!_transform.isLinear()) {
+        double length = std::sqrt(std::pow(end.x - start.x, 2) + std::pow(end.y - start.y, 2) +
+                                  std::pow(end.z - start.z, 2));
+        pieces = segment_count(length, _segment_length);
+    }
+    for (size_t i = 1; i < pieces; ++i) {
+        float fraction = static_cast<float>(i) / pieces;
+        _toolpath.append({start.x + (end.x - start.x) * fraction, start.y + (end.y - start.y) * fraction,
+                          start.z + (end.z - start.z) * fraction});
+    }
+    _toolpath.append(end);
+}
+
+/// @brief Adds an arc in the XY plane to the path, split into chords no longer than the segment length. Z moves
+/// linearly along the arc, giving a helix, and the radius blends from the start to the end one if they differ.
+/// @param end the tool position at the end of the arc, the same as the start for a full circle
+/// @param center_x, center_y the center of the arc
+/// @param clockwise direction of the arc seen from +Z
+void KinematicsPlanner::arc_to(const CartesianPoint &end, float center_x, float center_y, bool clockwise) {
+    CartesianPoint start = _toolpath.point(_toolpath.size() - 1);
+    double start_radius = std::hypot(start.x - center_x, start.y - center_y);
+    double end_radius = std::hypot(end.x - center_x, end.y - center_y);
+    double start_angle = std::atan2(start.y - center_y, start.x - center_x);
+    double sweep = std::atan2(end.y - center_y, end.x - center_x) - start_angle;
+    if (!clockwise and sweep <= 0) {
+        sweep += 2 * M_PI;
+    }
+    if (clockwise and sweep >= 0) {
+        sweep -= 2 * M_PI;
+    }
+
+    double arc_length = std::fabs(sweep) * 0.5 * (start_radius + end_radius);
+    size_t pieces = segment_count(std::hypot(arc_length, end.z - start.z), _segment_length);
+    for (size_t i = 1; i < pieces; ++i) {
+        double fraction = static_cast<double>(i) / pieces;
+        double angle = start_angle + sweep * fraction;
+        double radius = start_radius + (end_radius - start_radius) * fraction;
+        _toolpath.append({static_cast<float>(center_x + radius * std::cos(angle)),
+                          static_cast<float>(center_y + radius * std::sin(angle)),
+                          static_cast<float>(start.z + (end.z - start.z) * fraction)});
+    }
+    _toolpath.append(end);
+}
+
+/// @brief Removes the path, the next move starts from where the last one ended
+void KinematicsPlanner::clear() {
+    CartesianPoint last = _toolpath.point(_toolpath.size() - 1);
+    _toolpath.clear();
+    _toolpath.append(last);
+}
+
+/// @brief Returns the tool positions of the path, the start position first
+const ToolpathColumns &KinematicsPlanner::getToolpath() const {
+    return _toolpath;
+}
+
+/// @brief Returns the longest tool move between two path points of a segmented line or arc
+float KinematicsPlanner::getSegmentLength() const {
+    return _segment_length;
+}
+
+/// @brief Sets the longest tool move between two path points of a segmented line or arc
+/// @param segmentLength the new length, 1 by default, 0 disables segmentation
+void KinematicsPlanner::setSegmentLength(float segmentLength) {
+    _segment_length = segmentLength;
+}
+
+/// @brief Computes the motor positions of every point of the path in a single batch
+/// @param motor_positions one column per motor, as long as the path
+/// @return false if a point is out of reach
+bool KinematicsPlanner::transform(MotorColumns &motor_positions) const {
+    size_t count = _toolpath.size();
+    motor_positions.motor.resize(_transform.getMotorCount());
+    std::vector<float *> columns;
+    for (std::vector<float> &column : motor_positions.motor) {
+        column.resize(count);
+        columns.push_back(column.data());
+    }
+    return _transform.inverse_batch(_toolpath.x.data(), _toolpath.y.data(), _toolpath.z.data(), count,
+                                    columns.data());
+}
+
+/// @brief Plans the move of every motor for every segment of the path. The motors of a segment share one
+/// trapezoidal profile scaled by their distance, so they start and stop together and the motor positions move along
+/// a straight line, each motor staying within its limits. Each segment starts and ends at rest.
+/// @param limits max velocity and max acceleration of each motor
+/// @param moves getMotorCount() moves per segment, the moves of segment s starting at s * getMotorCount()
+/// @return false if the limits don't match the motors or a point is out of reach
+bool KinematicsPlanner::plan_moves(const std::vector<MotorLimits> &limits, std::vector<MotorMove> &moves) const {
+    size_t motor_count = _transform.getMotorCount();
+    bool limits_valid = limits.size() == motor_count;
+    for (size_t motor = 0; limits_valid and motor < motor_count; ++motor) {
+        limits_valid = limits[motor].max_velocity > 0 and limits[motor].max_acceleration > 0;
+    }
+    if (!limits_valid) {
+        Logger::instance().log(LOG_ERROR, LOG_FORMAT_MOTOR_LIMITS_INVALID, motor_count);
+        return false;
+    }
+
+    MotorColumns positions;
+    if (!transform(positions)) {
+        return false;
+    }
+    size_t segments = positions.size() > 0 ? positions.size() - 1 : 0;
+    moves.resize(segments * motor_count);
+    for (size_t segment = 0; segment < segments; ++segment) {
+        // Limits of the shared profile, which covers a distance of 1 and gets scaled by each motor's distance
+        double path_velocity = std::numeric_limits<double>::infinity();
+        double path_acceleration = std::numeric_limits<double>::infinity();
+        for (size_t motor = 0; motor < motor_count; ++motor) {
+            double distance = std::fabs(positions.motor[motor][segment + 1] - positions.motor[motor][segment]);
+            if (distance > 0) {
+                path_velocity = std::fmin(path_velocity, limits[motor].max_velocity / distance);
+                path_acceleration = std::fmin(path_acceleration, limits[motor].max_acceleration / distance);
+            }
+        }
+        double duration = 0;
+        if (std::isfinite(path_velocity)) {
+            duration = path_velocity * path_velocity / path_acceleration <= 1
+                       ? 1 / path_velocity + path_velocity / path_acceleration
+                       : 2 * std::sqrt(1 / path_acceleration);
+        }
+
+        for (size_t motor = 0; motor < motor_count; ++motor) {
+            float start = positions.motor[motor][segment];
+            float displacement = positions.motor[motor][segment + 1] - start;
+            float distance = std::fabs(displacement);
+            MotorMove &move = moves[segment * motor_count + motor];
+            move.start_position = start;
+            move.distance = distance;
+            move.direction = displacement > 0 ? 1.0f : displacement < 0 ? -1.0f : 0.0f;
+            move.max_velocity = distance > 0 ? static_cast<float>(path_velocity * distance) : 0.0f;
+            move.max_acceleration = distance > 0 ? static_cast<float>(path_acceleration * distance) : 0.0f;
+            move.duration = static_cast<float>(duration);
+        }
+    }
+    return true;
+}
+
+/// @brief Creates the controller running a motor move. Its position goes from 0 to the move distance, the motor
+/// position being start_position + direction * getCurrentPosition(). The trajectory file is disabled since the
+/// motors of a segment run together.
+/// @param move the motor move
+/// @return the controller, or nullptr when the motor stays put during the segment
+std::unique_ptr<StepperController> KinematicsPlanner::make_controller(const MotorMove &move) {
+    if (move.direction == 0) {
+        return nullptr;
+    }
+    std::unique_ptr<StepperController> controller(new StepperController(0, 0));
+    controller->set_goal(move.distance, move.max_velocity, move.max_acceleration);
+    controller->setTrajectoryFilePath("");
+    return controller;
+}
@@ -0,0 +1,146 @@
+//
+// Created by chu-chu on 10/19/26.
+//
+
+#ifndef URBAN_MACHINE_GENERIC_STEPPER_MOTOR_CONTROLLER_KINEMATICS_H
+#define URBAN_MACHINE_GENERIC_STEPPER_MOTOR_CONTROLLER_KINEMATICS_H
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "StepperController.h"
+
+struct CartesianPoint {
+    float x;
+    float y;
+    float z;
+};
+
+// Tool positions of a path, one contiguous vector per axis so transforms run over plain arrays
+struct ToolpathColumns {
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<float> z;
+
+    void append(const CartesianPoint &point);
+    void clear();
+    size_t size() const;
+    CartesianPoint point(size_t index) const;
+};
+
+// Motor positions of a path, one contiguous vector per motor
+struct MotorColumns {
+    std::vector<std::vector<float>> motor;
+
+    size_t size() const;
+};
+
+struct MotorLimits {
+    float max_velocity;
+    float max_acceleration;
+};
+
+// What one motor does during one segment of a path. StepperController only moves forward from a fixed initial
+// position, so the profile covers distance from 0 and direction tells which way the motor actually turns.
+struct MotorMove {
+    float start_position;
+    float distance;             // >= 0
+    float direction;            // 1 or -1, 0 when the motor stays put during the segment
+    float max_velocity;
+    float max_acceleration;
+    float duration;             // the same for every motor of a segment
+};
+
+
+// Maps tool positions to motor positions. inverse_batch() is the one to use for long paths: implementations run a
+// single branch free loop over the columns that the compiler can vectorize.
+class KinematicTransform {
+public:
+    virtual ~KinematicTransform() = default;
+
+    virtual size_t getMotorCount() const = 0;
+
+    // True if straight tool moves are straight motor moves, so lines don't need to be segmented
+    virtual bool isLinear() const = 0;
+
+    virtual bool inverse(const CartesianPoint &point, float *motor_positions) const = 0;
+
+    virtual bool inverse_batch(const float *x, const float *y, const float *z, size_t count,
+                               float *const *motor_positions) const = 0;
+};
+
+
+// One motor per axis
+class CartesianKinematics final : public KinematicTransform {
+public:
+    size_t getMotorCount() const override;
+    bool isLinear() const override;
+    bool inverse(const CartesianPoint &point, float *motor_positions) const override;
+    bool inverse_batch(const float *x, const float *y, const float *z, size_t count,
+                       float *const *motor_positions) const override;
+};
+
+
+// Two belts driven by motors A and B move X and Y together: A = X + Y, B = X - Y. Z has its own motor.
+class CoreXYKinematics final : public KinematicTransform {
+public:
+    size_t getMotorCount() const override;
+    bool isLinear() const override;
+    bool inverse(const CartesianPoint &point, float *motor_positions) const override;
+    bool inverse_batch(const float *x, const float *y, const float *z, size_t count,
+                       float *const *motor_positions) const override;
+};
+
+
+// Linear delta: three carriages on vertical towers placed every 120 degrees around the Z axis, the first one on the
+// +Y axis, each linked to the effector by arms of the same length. The motor positions are the carriage heights.
+class DeltaKinematics final : public KinematicTransform {
+public:
+    DeltaKinematics(float arm_length, float tower_radius);
+
+    size_t getMotorCount() const override;
+    bool isLinear() const override;
+    bool inverse(const CartesianPoint &point, float *motor_positions) const override;
+    bool inverse_batch(const float *x, const float *y, const float *z, size_t count,
+                       float *const *motor_positions) const override;
+
+private:
+    float _arm_length_squared;
+    float _tower_x[3];
+    float _tower_y[3];
+};
+
+
+// Builds a toolpath out of lines and arcs, splitting whatever is not a straight motor move into segments no longer
+// than the segment length, and turns it into synchronized per motor moves.
+class KinematicsPlanner {
+public:
+    KinematicsPlanner(const KinematicTransform &transform, const CartesianPoint &start);
+
+    void line_to(const CartesianPoint &end);
+
+    void arc_to(const CartesianPoint &end, float center_x, float center_y, bool clockwise);
+
+    void clear();
+
+    const ToolpathColumns &getToolpath() const;
+
+    float getSegmentLength() const;
+
+    void setSegmentLength(float segmentLength);
+
+    bool transform(MotorColumns &motor_positions) const;
+
+    bool plan_moves(const std::vector<MotorLimits> &limits, std::vector<MotorMove> &moves) const;
+
+    static std::unique_ptr<StepperController> make_controller(const MotorMove &move);
+
+private:
+    const KinematicTransform &_transform;
+    ToolpathColumns _toolpath;
+    float _segment_length;
+};
+
+
+#endif //URBAN_MACHINE_GENERIC_STEPPER_MOTOR_CONTROLLER_KINEMATICS_H
@@ -0,0 +1,325 @@
+//
+// Created by chu-chu on 10/19/26.
+//
+
+#include "Logger.h"
+
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+
+namespace {
+
+    const char *const LOG_FORMATS[LOG_FORMAT_COUNT] = {
+            "Creating Socket",
+            "acceleration_time = {}, acceleration_distance = {}, deceleration_time = {}, deceleration_distance = {}, "
+            "total_time = {}, total_distance = {}, cruise_time = {}, cruising_distance = {}",
+            "accelerating {} current_position = {} current_velocity = {} current_acceleration = {} "
+            "remaining_distance = {} distance_covered = {}",
+            "cruising {} current_position = {} current_velocity = {} current_acceleration = {} "
+            "remaining_distance = {} distance_covered = {}",
+            "decelerating {} current_position = {} current_velocity = {} current_acceleration = {} "
+            "remaining_distance = {} distance_covered = {}",
+            "max velocity is 0. Motor will cruise forever",
+            "max velocity cannot be less than initial velocity",
+            "it's not possible to hit a goal position less than the initial position with a positive max velocity",
+            "both initial and goal velocities are negative but the max velocity is less than the initial velocity "
+            "since we're moving in the other direction",
+            "Max acceleration is cannot be negative.",
+            "Potential Division by Zero Error, max_acceleration or max_velocity is zero.",
+            "the motor won't move, initial_position and goal_position are the same",
+            "this class only moves towards goal positions greater than the initial position",
+            "the motor cannot stop at the goal position from its initial velocity with the given max acceleration",
+            "this class doesn't handle negative goal positions, max velocities or max accelerations",
+            "the time step has to be greater than 0",
+            "the position tolerance has to be greater than 0 for adaptive sampling",
+            "Failed to open file for writing!",
+            "Failed to append run to trajectory archive!",
+            "Cannot follow trapezoidal velocity curve with the given parameters. Max velocity is not reached, "
+            "peaking at {}",
+            "Cannot follow trapezoidal velocity curve with the given parameters. total_time is less than 0",
+            "Sent data: {},{},{},{}",
+            "the tool position ({}, {}, {}) is out of reach of the machine",
+            "expected a positive max velocity and max acceleration for each of the {} motors",
+    };
+
+    const char *const LOG_LEVEL_NAMES[] = {"DEBUG", "INFO", "WARNING", "ERROR"};
+
+    // Wall clock time, only printed
+    int64_t now_ns() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    // Monotonic time the rate limit windows are measured in
+    int64_t steady_now_ns() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+}
+
+/// @brief Returns the process wide logger, starting its background thread on first use
+Logger &Logger::instance() {
+    static Logger logger;
+    return logger;
+}
+
+Logger::Logger() :
+        _level(LOG_DEBUG),
+        _rate_limit_window_ns(1000000000),
+        _dropped(0),
+        _reported_dropped(0),
+        _flush_requested(0),
+        _flush_completed(0),
+        _stopping(false) {
+    for (size_t i = 0; i < LOG_FORMAT_COUNT; ++i) {
+        _next_allowed_ns[i].store(0);
+        _suppressed[i].store(0);
+        _suppressed_level[i].store(LOG_DEBUG);
+    }
+    _thread = std::thread(&Logger::run, this);
+}
+
+/// @brief Destructor for Logger class. Writes every record still buffered before stopping the background thread.
+Logger::~Logger() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+    }
+    _wake.notify_all();
+    _thread.join();
+}
+
+/// @brief Blocks until every record logged so far, by any thread, has been written
+void Logger::flush() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    uint64_t target = ++_flush_requested;
+    _wake.notify_all();
+    _flushed.wait(lock, [&] { return _flush_completed >= target; });
+}
+
+/// @brief Returns the lowest level that is recorded
+LogLevel Logger::getLevel() const {
+    return _level.load();
+}
+
+/// @brief Sets the lowest level that is recorded. Calls below it return after a single relaxed load.
+/// @param level the new minimum level, LOG_DEBUG by default
+void Logger::setLevel(LogLevel level) {
+    _level.store(level);
+}
+
+/// @brief Returns the minimum time between two warnings or errors of the same format
+std::chrono::milliseconds Logger::getRateLimitWindow() const {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::nanoseconds(_rate_limit_window_ns.load()));
+}
+
+/// @brief Sets the minimum time between two warnings or errors of the same format. Repeats within the window are
+/// counted instead of recorded, and the count is reported with the next one or once the window is over.
+/// @param window the new window, 1 s by default, 0 disables rate limiting
+void Logger::setRateLimitWindow(std::chrono::milliseconds window) {
+    _rate_limit_window_ns.store(std::chrono::duration_cast<std::chrono::nanoseconds>(window).count());
+}
+
+/// @brief Returns the number of records lost because a thread's buffer was full
+uint64_t Logger::getDroppedRecordCount() const {
+    return _dropped.load();
+}
+
+/// @brief Records a message on the calling thread. Takes no lock and makes no system call once the thread's buffer
+/// exists; a full buffer drops the record rather than wait for the background thread.
+void Logger::record(LogLevel level, LogFormat format, const double *arguments, size_t argument_count) {
+    int64_t timestamp = now_ns();
+    uint32_t suppressed = 0;
+    if (level >= LOG_WARNING) {
+        int64_t window = _rate_limit_window_ns.load(std::memory_order_relaxed);
+        if (window > 0) {
+            int64_t steady_now = steady_now_ns();
+            int64_t next_allowed = _next_allowed_ns[format].load(std::memory_order_relaxed);
+            if (steady_now < next_allowed or
+                !_next_allowed_ns[format].compare_exchange_strong(next_allowed, steady_now + window,
+                                                                  std::memory_order_relaxed)) {
+                uint8_t suppressed_level = _suppressed_level[format].load(std::memory_order_relaxed);
+                while (suppressed_level < level and
+                       !_suppressed_level[format].compare_exchange_weak(suppressed_level, level,
+                                                                        std::memory_order_relaxed)) {
+                }
+                _suppressed[format].fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            suppressed = _suppressed[format].exchange(0, std::memory_order_relaxed);
+            _suppressed_level[format].store(LOG_DEBUG, std::memory_order_relaxed);
+        }
+    }
+
+    ThreadBuffer &buffer = thread_buffer();
+    uint64_t head = buffer.head.load(std::memory_order_relaxed);
+    if (head - buffer.tail.load(std::memory_order_acquire) >= ThreadBuffer::CAPACITY) {
+        _dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    LogRecord &entry = buffer.records[head % ThreadBuffer::CAPACITY];
+    entry.timestamp_ns = timestamp;
+    entry.suppressed = suppressed;
+    entry.format = format;
+    entry.level = level;
+    entry.argument_count = static_cast<uint8_t>(argument_count);
+    std::copy(arguments, arguments + argument_count, entry.arguments);
+    buffer.head.store(head + 1, std::memory_order_release);
+}
+
+/// @brief Returns the calling thread's buffer, registering it with the background thread on first use
+Logger::ThreadBuffer &Logger::thread_buffer() {
+    thread_local std::shared_ptr<ThreadBuffer> buffer;
+    if (!buffer) {
+        buffer = std::make_shared<ThreadBuffer>();
+        buffer->head.store(0);
+        buffer->tail.store(0);
+        std::lock_guard<std::mutex> lock(_mutex);
+        _buffers.push_back(buffer);
+    }
+    return *buffer;
+}
+
+/// @brief Formats a record as "[date time.microseconds] LEVEL message\n", each {} of the format being replaced by the
+/// next argument. A summary of rate limited repeats carries no arguments, its {} are shown as "...".
+/// @param record the record to format
+/// @param buffer where the text is written, always null terminated
+/// @param buffer_size size of buffer, longer lines are truncated
+/// @return the length of the text, without the terminating null
+size_t Logger::format_record(const LogRecord &record, char *buffer, size_t buffer_size) {
+    if (buffer_size == 0) {
+        return 0;
+    }
+    time_t seconds = static_cast<time_t>(record.timestamp_ns / 1000000000);
+    long microseconds = static_cast<long>(record.timestamp_ns % 1000000000 / 1000);
+    struct tm local_time;
+    localtime_r(&seconds, &local_time);
+    size_t length = strftime(buffer, buffer_size, "[%Y-%m-%d %H:%M:%S", &local_time);
+
+    auto append = [&](const char *text, size_t text_length) {
+        size_t count = std::min(text_length, buffer_size - 1 - length);
+        memcpy(buffer + length, text, count);
+        length += count;
+    };
+    char number[64];
+    int number_length = snprintf(number, sizeof(number), ".%06ld] %s ", microseconds,
+                                 LOG_LEVEL_NAMES[std::min<uint8_t>(record.level, LOG_ERROR)]);
+    append(number, number_length);
+
+    const char *format = record.format < LOG_FORMAT_COUNT ? LOG_FORMATS[record.format] : "unknown log format";
+    bool summary = record.argument_count == LOG_SUPPRESSION_SUMMARY;
+    if (summary) {
+        number_length = snprintf(number, sizeof(number), "%u more like: ", record.suppressed);
+        append(number, number_length);
+    }
+    size_t argument = 0;
+    for (const char *cursor = format; *cursor != '\0'; ++cursor) {
+        if (cursor[0] == '{' and cursor[1] == '}' and summary) {
+            append("...", 3);
+            ++cursor;
+        }
+        else if (cursor[0] == '{' and cursor[1] == '}' and argument < record.argument_count) {
+            number_length = snprintf(number, sizeof(number), "%g", record.arguments[argument++]);
+            append(number, number_length);
+            ++cursor;
+        }
+        else {
+            append(cursor, 1);
+        }
+    }
+    if (!summary and record.suppressed > 0) {
+        number_length = snprintf(number, sizeof(number), " (%u similar suppressed)", record.suppressed);
+        append(number, number_length);
+    }
+    append("\n", 1);
+    buffer[length] = '\0';
+    return length;
+}
+
+/// @brief Main loop of the background thread. Wakes up every 10 ms, or right away on flush() or shutdown, and
+/// writes everything the threads recorded since the previous pass.
+void Logger::run() {
+    std::vector<LogRecord> pending;
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (true) {
+        _wake.wait_for(lock, std::chrono::milliseconds(10),
+                       [&] { return _stopping or _flush_requested != _flush_completed; });
+        uint64_t requested = _flush_requested;
+        bool stopping = _stopping;
+        lock.unlock();
+
+        drain(pending);
+
+        lock.lock();
+        _flush_completed = requested;
+        _flushed.notify_all();
+        if (stopping) {
+            return;
+        }
+    }
+}
+
+/// @brief Moves the records out of every thread buffer, orders them by timestamp and writes them
+/// @param pending scratch vector reused from pass to pass
+void Logger::drain(std::vector<LogRecord> &pending) {
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        // Buffers of threads that exited and have been emptied are no longer needed
+        _buffers.erase(std::remove_if(_buffers.begin(), _buffers.end(), [](const std::shared_ptr<ThreadBuffer> &b) {
+            return b.use_count() == 1 and b->head.load() == b->tail.load();
+        }), _buffers.end());
+        buffers = _buffers;
+    }
+
+    pending.clear();
+    for (const std::shared_ptr<ThreadBuffer> &buffer : buffers) {
+        uint64_t tail = buffer->tail.load(std::memory_order_relaxed);
+        uint64_t head = buffer->head.load(std::memory_order_acquire);
+        for (; tail < head; ++tail) {
+            pending.push_back(buffer->records[tail % ThreadBuffer::CAPACITY]);
+        }
+        buffer->tail.store(tail, std::memory_order_release);
+    }
+
+    // Report repeats whose window ran out without another message of the same format to carry the count
+    int64_t now = now_ns();
+    int64_t steady_now = steady_now_ns();
+    for (size_t format = 0; format < LOG_FORMAT_COUNT; ++format) {
+        if (_suppressed[format].load(std::memory_order_relaxed) > 0 and
+            steady_now >= _next_allowed_ns[format].load(std::memory_order_relaxed)) {
+            LogRecord summary = LogRecord();
+            summary.timestamp_ns = now;
+            summary.suppressed = _suppressed[format].exchange(0, std::memory_order_relaxed);
+            summary.format = static_cast<uint16_t>(format);
+            summary.level = _suppressed_level[format].exchange(LOG_DEBUG, std::memory_order_relaxed);
+            summary.argument_count = LOG_SUPPRESSION_SUMMARY;
+            if (summary.suppressed > 0) {
+                pending.push_back(summary);
+            }
+        }
+    }
+
+    std::stable_sort(pending.begin(), pending.end(), [](const LogRecord &a, const LogRecord &b) {
+        return a.timestamp_ns < b.timestamp_ns;
+    });
+    char line[1024];
+    for (const LogRecord &record : pending) {
+        size_t length = format_record(record, line, sizeof(line));
+        fwrite(line, 1, length, record.level >= LOG_WARNING ? stderr : stdout);
+    }
+
+    uint64_t dropped = _dropped.load(std::memory_order_relaxed);
+    if (dropped != _reported_dropped) {
+        fprintf(stderr, "%llu log records dropped, the logging thread could not keep up\n",
+                static_cast<unsigned long long>(dropped - _reported_dropped));
+        _reported_dropped = dropped;
+    }
+    if (!pending.empty()) {
+        fflush(stdout);
+        fflush(stderr);
+    }
+}
@@ -0,0 +1,145 @@
+//
+// Created by chu-chu on 10/19/26.
+//
+
+#ifndef URBAN_MACHINE_GENERIC_STEPPER_MOTOR_CONTROLLER_LOGGER_H
+#define URBAN_MACHINE_GENERIC_STEPPER_MOTOR_CONTROLLER_LOGGER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+enum LogLevel : uint8_t {
+    LOG_DEBUG,
+    LOG_INFO,
+    LOG_WARNING,
+    LOG_ERROR
+};
+
+// Every message the controller can log. The format strings, with {} standing for each argument, are in Logger.cpp
+// so the hot path only records the id and the numbers.
+enum LogFormat : uint16_t {
+    LOG_FORMAT_CREATING_SOCKET,
+    LOG_FORMAT_MOTION_PARAMETERS,
+    LOG_FORMAT_ACCELERATING_VALUES,
+    LOG_FORMAT_CRUISING_VALUES,
+    LOG_FORMAT_DECELERATING_VALUES,
+    LOG_FORMAT_MAX_VELOCITY_ZERO,
+    LOG_FORMAT_MAX_VELOCITY_BELOW_INITIAL,
+    LOG_FORMAT_GOAL_BEHIND_WITH_POSITIVE_MAX_VELOCITY,
+    LOG_FORMAT_NEGATIVE_MAX_VELOCITY_BELOW_INITIAL,
+    LOG_FORMAT_NEGATIVE_MAX_ACCELERATION,
+    LOG_FORMAT_DIVISION_BY_ZERO,
+    LOG_FORMAT_GOAL_EQUALS_INITIAL,
+    LOG_FORMAT_GOAL_BEHIND_INITIAL,
+    LOG_FORMAT_CANNOT_STOP_AT_GOAL,
+    LOG_FORMAT_NEGATIVE_PARAMETERS,
+    LOG_FORMAT_TIME_STEP_NOT_POSITIVE,
+    LOG_FORMAT_TOLERANCE_NOT_POSITIVE,
+    LOG_FORMAT_TRAJECTORY_FILE_OPEN_FAILED,
+    LOG_FORMAT_ARCHIVE_APPEND_FAILED,
+    LOG_FORMAT_MAX_VELOCITY_NOT_REACHED,
+    LOG_FORMAT_TOTAL_TIME_NOT_POSITIVE,
+    LOG_FORMAT_DATA_SENT,
+    LOG_FORMAT_POINT_UNREACHABLE,
+    LOG_FORMAT_MOTOR_LIMITS_INVALID,
+    LOG_FORMAT_COUNT
+};
+
+const size_t LOG_MAX_ARGUMENTS = 8;
+
+// argument_count of a record reporting rate limited messages that were never followed by an allowed one
+const uint8_t LOG_SUPPRESSION_SUMMARY = 0xFF;
+
+struct LogRecord {
+    int64_t timestamp_ns;
+    uint32_t suppressed;        // records of the same format dropped by the rate limit just before this one
+    uint16_t format;
+    uint8_t level;
+    uint8_t argument_count;
+    double arguments[LOG_MAX_ARGUMENTS];
+};
+
+
+// Asynchronous binary logger. log() copies the format id, level, timestamp and arguments into a lock free ring owned
+// by the calling thread; a background thread merges the rings, formats the records and writes them, debug and info
+// to stdout, warnings and errors to stderr. Warnings and errors are rate limited per format.
+class Logger {
+public:
+    static Logger &instance();
+
+    virtual ~Logger();
+
+    Logger(const Logger &) = delete;
+
+    Logger &operator=(const Logger &) = delete;
+
+    template<typename... Arguments>
+    void log(LogLevel level, LogFormat format, Arguments... arguments) {
+        static_assert(sizeof...(Arguments) <= LOG_MAX_ARGUMENTS, "too many log arguments");
+        if (level < _level.load(std::memory_order_relaxed)) {
+            return;
+        }
+        const double values[] = {static_cast<double>(arguments)..., 0.0};
+        record(level, format, values, sizeof...(Arguments));
+    }
+
+    void flush();
+
+    LogLevel getLevel() const;
+
+    void setLevel(LogLevel level);
+
+    std::chrono::milliseconds getRateLimitWindow() const;
+
+    void setRateLimitWindow(std::chrono::milliseconds window);
+
+    uint64_t getDroppedRecordCount() const;
+
+    static size_t format_record(const LogRecord &record, char *buffer, size_t buffer_size);
+
+private:
+    // Single producer (the owning thread), single consumer (the background thread)
+    struct ThreadBuffer {
+        static const size_t CAPACITY = 4096;
+        std::atomic<uint64_t> head;
+        std::atomic<uint64_t> tail;
+        LogRecord records[CAPACITY];
+    };
+
+    std::atomic<LogLevel> _level;
+    std::atomic<int64_t> _rate_limit_window_ns;
+    std::atomic<int64_t> _next_allowed_ns[LOG_FORMAT_COUNT];    // steady clock, wall clock steps do not move it
+    std::atomic<uint32_t> _suppressed[LOG_FORMAT_COUNT];
+    std::atomic<uint8_t> _suppressed_level[LOG_FORMAT_COUNT];    // highest level among the suppressed records
+    std::atomic<uint64_t> _dropped;
+    uint64_t _reported_dropped;         // only touched by the background thread
+
+    std::mutex _mutex;
+    std::condition_variable _wake;
+    std::condition_variable _flushed;
+    std::vector<std::shared_ptr<ThreadBuffer>> _buffers;
+    uint64_t _flush_requested;
+    uint64_t _flush_completed;
+    bool _stopping;
+    std::thread _thread;
+
+    Logger();
+
+    void record(LogLevel level, LogFormat format, const double *arguments, size_t argument_count);
+
+    ThreadBuffer &thread_buffer();
+
+    void run();
+
+    void drain(std::vector<LogRecord> &pending);
+};
+
+
+#endif //URBAN_MACHINE_GENERIC_STEPPER_MOTOR_CONTROLLER_LOGGER_H
@@ -0,0 +1,39 @@
+//
+// Created by chu-chu on 2/24/23.
+//
+
+#ifndef URBAN_MACHINE_GENERIC_STEPPER_MOTOR_CONTROLLER_MOTORCONTROLLER_H
+#define URBAN_MACHINE_GENERIC_STEPPER_MOTOR_CONTROLLER_MOTORCONTROLLER_H
+
+
+// Abstract interface every motor driver implements. A move is planned with begin_move(), advanced one time step per
+// tick() until it returns false and closed with finish_move(); step() runs the three in a row.
+class MotorController {
+public:
+    virtual ~MotorController() {}
+
+    virtual void set_goal(float position, float velocity, float acceleration) = 0;
+
+    virtual void step() = 0;
+
+    virtual bool begin_move() = 0;
+
+    virtual bool tick() = 0;
+
+    virtual void finish_move() = 0;
+
+    virtual void request_stop() = 0;
+
+    virtual float getCurrentPosition() const = 0;
+
+    virtual float getCurrentVelocity() const = 0;
+
+    virtual float getProgress() const = 0;
+
+    virtual bool isMoveActive() const = 0;
+
+    virtual bool isMoveCancelled() const = 0;
+};
+
+
+#endif //URBAN_MACHINE_GENERIC_STEPPER_MOTOR_CONTROLLER_MOTORCONTROLLER_H
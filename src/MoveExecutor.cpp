@@ -0,0 +1,182 @@
+//
+// Created by chu-chu on 10/19/26.
+//
+
+#include "MoveExecutor.h"
+
+#include <algorithm>
+
+/// @brief Constructor for an empty handle that does not refer to any move
+MoveHandle::MoveHandle() :
+        _controller(nullptr) {}
+
+MoveHandle::MoveHandle(MotorController *controller, std::shared_future<MoveStatus> future) :
+        _controller(controller),
+        _future(future) {}
+
+/// @brief Returns true if the handle refers to a submitted move
+bool MoveHandle::isValid() const {
+    return _controller != nullptr and _future.valid();
+}
+
+/// @brief Stops the move. The motor decelerates at max acceleration until it stands still, after which the move
+/// completes with MOVE_CANCELLED. Cancelling a finished move has no effect.
+void MoveHandle::cancel() {
+    if (isValid() and !isDone()) {
+        _controller->request_stop();
+    }
+}
+
+/// @brief Returns the fraction of the planned move time elapsed so far, between 0 and 1
+float MoveHandle::getProgress() const {
+    return isValid() ? _controller->getProgress() : 0.0f;
+}
+
+/// @brief Returns true once the move has completed, been cancelled or been rejected, without blocking
+bool MoveHandle::isDone() const {
+    return _future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+/// @brief Blocks until the move is over
+/// @return how the move ended
+MoveStatus MoveHandle::wait() const {
+    return _future.get();
+}
+
+/// @brief Returns the future the move's status is published through, for callers combining it with other futures
+const std::shared_future<MoveStatus> &MoveHandle::getFuture() const {
+    return _future;
+}
+
+
+/// @brief Constructor for MoveExecutor class. Starts the worker threads.
+/// @param worker_count number of threads ticking moves, at least one is started
+/// @param tick_period wall clock time between two ticks of the same move. 0 runs the moves as fast as possible,
+/// the controller time step (0.1 s) replays them in real time. Controllers streaming to the plot socket need it to
+/// be drawn in real time, their tick() does not wait.
+MoveExecutor::MoveExecutor(size_t worker_count, std::chrono::microseconds tick_period) :
+        _tick_period(tick_period),
+        _stopping(false) {
+    worker_count = std::max<size_t>(1, worker_count);
+    for (size_t i = 0; i < worker_count; ++i) {
+        std::unique_ptr<Worker> worker(new Worker());
+        worker->load.store(0);
+        _workers.push_back(std::move(worker));
+    }
+    for (auto &worker : _workers) {
+        worker->thread = std::thread(&MoveExecutor::run_worker, this, std::ref(*worker));
+    }
+}
+
+/// @brief Destructor for MoveExecutor class. Moves still running are stopped with a controlled deceleration and
+/// complete with MOVE_CANCELLED before the worker threads are joined.
+MoveExecutor::~MoveExecutor() {
+    _stopping.store(true);
+    for (auto &worker : _workers) {
+        {
+            std::lock_guard<std::mutex> lock(worker->mutex);
+        }
+        worker->wake.notify_all();
+    }
+    for (auto &worker : _workers) {
+        worker->thread.join();
+    }
+}
+
+/// @brief Plans a move on the calling thread and queues it on the least loaded worker. The controller must have its
+/// goal set, and must not be stepped or submitted again until the move is over.
+/// @param controller the controller to move, it has to stay alive until the returned handle is done
+/// @return a handle to cancel, monitor and wait for the move. It is done right away with MOVE_REJECTED if the move
+/// failed the pre motion sanity checks.
+MoveHandle MoveExecutor::submit(MotorController &controller) {
+    Move move;
+    move.controller = &controller;
+    std::shared_future<MoveStatus> future = move.promise.get_future().share();
+    if (!controller.begin_move()) {
+        move.promise.set_value(MOVE_REJECTED);
+        return MoveHandle(&controller, future);
+    }
+
+    Worker *target = _workers.front().get();
+    for (auto &worker : _workers) {
+        if (worker->load.load() < target->load.load()) {
+            target = worker.get();
+        }
+    }
+
+    target->load.fetch_add(1);
+    {
+        std::lock_guard<std::mutex> lock(target->mutex);
+        target->pending.push_back(std::move(move));
+    }
+    target->wake.notify_one();
+    return MoveHandle(&controller, future);
+}
+
+/// @brief Blocks until every move in handles is over
+/// @param handles the moves to wait for, invalid handles are skipped
+void MoveExecutor::wait_all(const std::vector<MoveHandle> &handles) {
+    for (const MoveHandle &handle : handles) {
+        if (handle.isValid()) {
+            handle.getFuture().wait();
+        }
+    }
+}
+
+/// @brief Returns the number of moves submitted and not finished yet, over all workers
+size_t MoveExecutor::getActiveMoveCount() const {
+    size_t count = 0;
+    for (const auto &worker : _workers) {
+        count += worker->load.load();
+    }
+    return count;
+}
+
+/// @brief Main loop of a worker thread. Each pass ticks every active move once and retires the moves that are over.
+/// @param worker the worker owned by this thread
+/// @details The worker sleeps on its condition variable while it has nothing to tick. When a tick period is set,
+/// passes are paced against a fixed deadline so the time spent ticking does not add up to drift.
+void MoveExecutor::run_worker(Worker &worker) {
+    std::vector<Move> active;
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now();
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(worker.mutex);
+            if (active.empty()) {
+                worker.wake.wait(lock, [&] { return !worker.pending.empty() or _stopping.load(); });
+                deadline = std::chrono::steady_clock::now();
+            }
+            if (active.empty() and worker.pending.empty() and _stopping.load()) {
+                return;
+            }
+            for (Move &move : worker.pending) {
+                active.push_back(std::move(move));
+            }
+            worker.pending.clear();
+        }
+
+        for (size_t i = 0; i < active.size();) {
+            MotorController *controller = active[i].controller;
+            if (_stopping.load()) {
+                controller->request_stop();
+            }
+            if (controller->tick()) {
+                ++i;
+                continue;
+            }
+            controller->finish_move();
+            worker.load.fetch_sub(1);
+            active[i].promise.set_value(controller->isMoveCancelled() ? MOVE_CANCELLED : MOVE_COMPLETED);
+            if (i + 1 != active.size()) {
+                active[i] = std::move(active.back());
+            }
+            active.pop_back();
+        }
+
+        if (_tick_period.count() > 0 and !active.empty()) {
+            deadline += _tick_period;
+            std::this_thread::sleep_until(deadline);
+        }
+    }
+}
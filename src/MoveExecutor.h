@@ -0,0 +1,95 @@
+//
+// Created by chu-chu on 10/19/26.
+//
+
+#ifndef URBAN_MACHINE_GENERIC_STEPPER_MOTOR_CONTROLLER_MOVEEXECUTOR_H
+#define URBAN_MACHINE_GENERIC_STEPPER_MOTOR_CONTROLLER_MOVEEXECUTOR_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "MotorController.h"
+
+enum MoveStatus {
+    MOVE_COMPLETED,     // the motor reached the end of its trajectory
+    MOVE_CANCELLED,     // the move was stopped early with cancel(), the motor decelerated to a stop
+    MOVE_REJECTED       // the pre motion sanity checks failed, the motor never moved
+};
+
+
+// Handle to a move submitted to a MoveExecutor. Copies refer to the same move.
+class MoveHandle {
+public:
+    MoveHandle();
+
+    bool isValid() const;
+
+    void cancel();
+
+    float getProgress() const;
+
+    bool isDone() const;
+
+    MoveStatus wait() const;
+
+    const std::shared_future<MoveStatus> &getFuture() const;
+
+private:
+    friend class MoveExecutor;
+
+    MoveHandle(MotorController *controller, std::shared_future<MoveStatus> future);
+
+    MotorController *_controller;
+    std::shared_future<MoveStatus> _future;
+};
+
+
+// Runs moves on a fixed pool of worker threads. Each worker ticks all of its moves in turn, so any number of axes
+// share the pool instead of blocking a thread each. The executor's tick period is the only pacing: a tick() that
+// waited would hold up every other move of its worker. Controllers must outlive their move.
+class MoveExecutor {
+public:
+    explicit MoveExecutor(size_t worker_count = 1,
+                          std::chrono::microseconds tick_period = std::chrono::microseconds(0));
+
+    virtual ~MoveExecutor();
+
+    MoveExecutor(const MoveExecutor &) = delete;
+
+    MoveExecutor &operator=(const MoveExecutor &) = delete;
+
+    MoveHandle submit(MotorController &controller);
+
+    static void wait_all(const std::vector<MoveHandle> &handles);
+
+    size_t getActiveMoveCount() const;
+
+private:
+    struct Move {
+        MotorController *controller;
+        std::promise<MoveStatus> promise;
+    };
+
+    struct Worker {
+        std::thread thread;
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::vector<Move> pending;
+        std::atomic<size_t> load;
+    };
+
+    std::vector<std::unique_ptr<Worker>> _workers;
+    std::chrono::microseconds _tick_period;
+    std::atomic<bool> _stopping;
+
+    void run_worker(Worker &worker);
+};
+
+
+#endif //URBAN_MACHINE_GENERIC_STEPPER_MOTOR_CONTROLLER_MOVEEXECUTOR_H
@@ -0,0 +1,278 @@
+//
+// Created by chu-chu on 10/19/26.
+//
+
+#include "SessionJournal.h"
+
+#include <cstring>
+
+namespace {
+
+    // Compares the raw bits, so -0 differs from 0 and a NaN matches the same NaN
+    bool same_bits(float a, float b) {
+        return memcmp(&a, &b, sizeof(float)) == 0;
+    }
+
+    bool same_state(const StepperController &controller, const JournalRecord &record) {
+        return same_bits(controller.getCurrentPosition(), record.values[0]) and
+               same_bits(controller.getCurrentVelocity(), record.values[1]) and
+               same_bits(controller.getCurrentAcceleration(), record.values[2]) and
+               same_bits(controller.getTimeElapsed(), record.values[3]) and
+               same_bits(controller.getProgress(), record.values[4]);
+    }
+
+}
+
+/// @brief Constructor for JournalingController class. Creates (or truncates) the journal and writes its header.
+/// @param controller the controller every call is forwarded to, it must outlive the journaling controller
+/// @param path path of the journal. isOpen() returns false if it cannot be created, calls are still forwarded.
+JournalingController::JournalingController(StepperController &controller, const std::string &path) :
+        _controller(controller),
+        _file(fopen(path.c_str(), "wb")),
+        _start(std::chrono::steady_clock::now()),
+        _stop_requested(false) {
+    if (_file == nullptr) {
+        perror("Failed to open session journal");
+        return;
+    }
+    // Records are small and frequent, let stdio batch them into large writes
+    setvbuf(_file, nullptr, _IOFBF, 1 << 16);
+    JournalHeader header = JournalHeader();
+    memcpy(header.magic, "SMJR", 4);
+    header.version = JOURNAL_VERSION;
+    header.record_size = sizeof(JournalRecord);
+    header.unix_time_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    fwrite(&header, sizeof(header), 1, _file);
+}
+
+/// @brief Destructor for JournalingController class. Writes out whatever is still buffered and closes the journal.
+JournalingController::~JournalingController() {
+    if (_file != nullptr) {
+        fclose(_file);
+    }
+}
+
+/// @brief Returns true if the journal was created
+bool JournalingController::isOpen() const {
+    return _file != nullptr;
+}
+
+/// @brief Appends a record to the journal
+void JournalingController::write(JournalRecordType type, uint8_t flags, float v0, float v1, float v2, float v3,
+                                 float v4) {
+    if (_file == nullptr) {
+        return;
+    }
+    JournalRecord record = {std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - _start).count(), type, flags, 0, {v0, v1, v2, v3, v4}};
+    fwrite(&record, sizeof(record), 1, _file);
+}
+
+/// @brief Appends a record holding the state of the controller
+void JournalingController::write_state(JournalRecordType type, uint8_t flags) {
+    write(type, flags, _controller.getCurrentPosition(), _controller.getCurrentVelocity(),
+          _controller.getCurrentAcceleration(), _controller.getTimeElapsed(), _controller.getProgress());
+}
+
+/// @brief Records the new goal and forwards it to the controller
+void JournalingController::set_goal(float position, float velocity, float acceleration) {
+    write(JOURNAL_SET_GOAL, 0, position, velocity, acceleration);
+    _controller.set_goal(position, velocity, acceleration);
+}
+
+/// @brief Runs a whole move through the journaling begin_move(), tick() and finish_move(), paced like the
+/// controller's own step()
+void JournalingController::step() {
+    if (!begin_move()) {
+        return;
+    }
+    std::chrono::milliseconds tick_period = _controller.getRealTimeTickPeriod();
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now();
+    while (tick()) {
+        if (tick_period.count() > 0) {
+            deadline += tick_period;
+            std::this_thread::sleep_until(deadline);
+        }
+    }
+    finish_move();
+}
+
+/// @brief Records every parameter the move depends on, however they were set, then plans the move
+/// @return the result of the controller's begin_move()
+bool JournalingController::begin_move() {
+    _stop_requested.store(false);
+    write(JOURNAL_MOTION_PARAMETERS, 0, _controller.getInitialPosition(), _controller.getInitialVelocity(),
+          _controller.getGoalPosition(), _controller.getMaxVelocity(), _controller.getMaxAcceleration());
+    write(JOURNAL_SAMPLING_PARAMETERS, static_cast<uint8_t>(_controller.getSamplingMode()),
+          _controller.getTimeStep(), _controller.getPositionTolerance());
+    bool started = _controller.begin_move();
+    write(JOURNAL_BEGIN_MOVE, started ? JOURNAL_RESULT : 0);
+    return started;
+}
+
+/// @brief Hands a pending stop request to the controller, ticks it and records the state it ends up in
+/// @return the result of the controller's tick()
+bool JournalingController::tick() {
+    uint8_t flags = 0;
+    if (_stop_requested.exchange(false)) {
+        _controller.request_stop();
+        flags |= JOURNAL_STOP;
+    }
+    bool moving = _controller.tick();
+    write_state(JOURNAL_TICK, moving ? flags | JOURNAL_RESULT : flags);
+    return moving;
+}
+
+/// @brief Closes the move and records its final state. Flushes the journal so every finished move is on disk.
+void JournalingController::finish_move() {
+    _controller.finish_move();
+    write_state(JOURNAL_FINISH_MOVE, 0);
+    if (_file != nullptr) {
+        fflush(_file);
+    }
+}
+
+/// @brief Asks the running move to stop at the next tick. Safe to call from any thread.
+void JournalingController::request_stop() {
+    _stop_requested.store(true);
+}
+
+float JournalingController::getCurrentPosition() const {
+    return _controller.getCurrentPosition();
+}
+
+float JournalingController::getCurrentVelocity() const {
+    return _controller.getCurrentVelocity();
+}
+
+float JournalingController::getProgress() const {
+    return _controller.getProgress();
+}
+
+bool JournalingController::isMoveActive() const {
+    return _controller.isMoveActive();
+}
+
+bool JournalingController::isMoveCancelled() const {
+    return _controller.isMoveCancelled();
+}
+
+
+/// @brief Constructor for JournalReplayer class. Reads every complete record of a journal.
+/// @param path path of the journal. isOpen() returns false if it is missing or not a journal.
+JournalReplayer::JournalReplayer(const std::string &path) :
+        _open(false) {
+    FILE *file = fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        perror("Failed to open session journal");
+        return;
+    }
+    JournalHeader header;
+    if (fread(&header, sizeof(header), 1, file) != 1 or memcmp(header.magic, "SMJR", 4) != 0 or
+        header.version != JOURNAL_VERSION or header.record_size != sizeof(JournalRecord)) {
+        fprintf(stderr, "%s is not a session journal\n", path.c_str());
+        fclose(file);
+        return;
+    }
+    // A session that crashed may end with a partial record, it is left out
+    JournalRecord record;
+    while (fread(&record, sizeof(record), 1, file) == 1) {
+        _records.push_back(record);
+    }
+    fclose(file);
+    _open = true;
+}
+
+/// @brief Returns true if the journal was read
+bool JournalReplayer::isOpen() const {
+    return _open;
+}
+
+/// @brief Returns the number of records in the journal
+size_t JournalReplayer::getRecordCount() const {
+    return _records.size();
+}
+
+/// @brief Returns record number index
+const JournalRecord &JournalReplayer::getRecord(size_t index) const {
+    return _records[index];
+}
+
+/// @brief Runs the recorded calls on a new StepperController, one per recorded move, and compares each result and
+/// the state after each tick to the recorded ones bit for bit. The replay writes no trajectory file, archive or
+/// telemetry.
+/// @param original_speed true to wait for each record's timestamp, false to replay as fast as possible
+/// @return the number of moves, ticks and mismatches, and how long the session took against the replay
+JournalReplayResult JournalReplayer::replay(bool original_speed) const {
+    JournalReplayResult result = {0, 0, 0, _records.size(), std::chrono::nanoseconds(0),
+                                  std::chrono::nanoseconds(0)};
+    std::unique_ptr<StepperController> controller;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < _records.size(); ++i) {
+        const JournalRecord &record = _records[i];
+        if (original_speed) {
+            std::this_thread::sleep_until(start + std::chrono::nanoseconds(record.timestamp_ns));
+        }
+        bool matched = true;
+        switch (record.type) {
+            case JOURNAL_SET_GOAL:
+                if (controller) {
+                    controller->set_goal(record.values[0], record.values[1], record.values[2]);
+                }
+                break;
+            case JOURNAL_MOTION_PARAMETERS:
+                controller.reset(new StepperController(record.values[0], record.values[1]));
+                controller->set_goal(record.values[2], record.values[3], record.values[4]);
+                controller->setTrajectoryFilePath("");
+                break;
+            case JOURNAL_SAMPLING_PARAMETERS:
+                if (controller) {
+                    controller->setTimeStep(record.values[0]);
+                    controller->setPositionTolerance(record.values[1]);
+                    controller->setSamplingMode(static_cast<SamplingMode>(record.flags));
+                }
+                break;
+            case JOURNAL_BEGIN_MOVE: {
+                bool started = controller and controller->begin_move();
+                matched = started == ((record.flags & JOURNAL_RESULT) != 0);
+                result.moves += started ? 1 : 0;
+                break;
+            }
+            case JOURNAL_TICK:
+                if (!controller) {
+                    matched = false;
+                    break;
+                }
+                if (record.flags & JOURNAL_STOP) {
+                    controller->request_stop();
+                }
+                matched = controller->tick() == ((record.flags & JOURNAL_RESULT) != 0) and
+                          same_state(*controller, record);
+                ++result.ticks;
+                break;
+            case JOURNAL_FINISH_MOVE:
+                if (!controller) {
+                    matched = false;
+                    break;
+                }
+                controller->finish_move();
+                matched = same_state(*controller, record);
+                break;
+            default:
+                matched = false;
+                break;
+        }
+        if (!matched) {
+            if (result.mismatches == 0) {
+                result.first_mismatch = i;
+            }
+            ++result.mismatches;
+        }
+    }
+    result.replay_duration = std::chrono::steady_clock::now() - start;
+    if (!_records.empty()) {
+        result.recorded_duration = std::chrono::nanoseconds(_records.back().timestamp_ns);
+    }
+    return result;
+}
@@ -0,0 +1,126 @@
+//
+// Created by chu-chu on 10/19/26.
+//
+
+#ifndef URBAN_MACHINE_GENERIC_STEPPER_MOTOR_CONTROLLER_SESSIONJOURNAL_H
+#define URBAN_MACHINE_GENERIC_STEPPER_MOTOR_CONTROLLER_SESSIONJOURNAL_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "StepperController.h"
+
+// Layout of a session journal (little endian):
+//   JournalHeader                            64 bytes
+//   JournalRecord, JournalRecord, ...        32 bytes each, in the order the calls were made
+// Timestamps are steady clock nanoseconds since the journal was opened. Values are stored as the raw float bits the
+// controller produced, so a replay can be compared bit for bit.
+
+const uint32_t JOURNAL_VERSION = 1u;
+
+enum JournalRecordType : uint8_t {
+    JOURNAL_SET_GOAL,               // goal position, max velocity, max acceleration
+    JOURNAL_MOTION_PARAMETERS,      // initial position, initial velocity, goal position, max velocity, max acceleration
+    JOURNAL_SAMPLING_PARAMETERS,    // time step, position tolerance, flags: sampling mode
+    JOURNAL_BEGIN_MOVE,             // flags: JOURNAL_RESULT
+    JOURNAL_TICK,                   // position, velocity, acceleration, time elapsed, progress after the tick
+    JOURNAL_FINISH_MOVE             // position, velocity, acceleration, time elapsed, progress after the move
+};
+
+const uint8_t JOURNAL_RESULT = 1u;          // begin_move() or tick() returned true
+const uint8_t JOURNAL_STOP = 2u;            // a stop request was handed to the controller just before the tick
+
+struct JournalHeader {
+    char magic[4];                  // "SMJR"
+    uint32_t version;
+    uint32_t record_size;
+    uint32_t reserved0;
+    int64_t unix_time_ns;
+    uint64_t reserved[5];
+};
+
+struct JournalRecord {
+    int64_t timestamp_ns;
+    uint8_t type;
+    uint8_t flags;
+    uint16_t reserved;
+    float values[5];
+};
+
+static_assert(sizeof(JournalHeader) == 64, "journal header must stay 64 bytes");
+static_assert(sizeof(JournalRecord) == 32, "journal record must stay 32 bytes");
+
+struct JournalReplayResult {
+    size_t moves;
+    size_t ticks;
+    size_t mismatches;              // records whose replayed result or state differs from the recorded one
+    size_t first_mismatch;          // index of the first of them, the record count if there are none
+    std::chrono::nanoseconds recorded_duration;
+    std::chrono::nanoseconds replay_duration;
+};
+
+
+// Records every call made to a StepperController, with the parameters each move ran with and the state after every
+// tick, while forwarding the calls to it. Stop requests can come from any thread; they are handed to the controller
+// at the start of the next tick so the journal knows exactly which tick saw them.
+class JournalingController final : public MotorController {
+public:
+    JournalingController(StepperController &controller, const std::string &path);
+
+    ~JournalingController() override;
+
+    JournalingController(const JournalingController &) = delete;
+
+    JournalingController &operator=(const JournalingController &) = delete;
+
+    bool isOpen() const;
+
+    void set_goal(float position, float velocity, float acceleration) override;
+    void step() override;
+    bool begin_move() override;
+    bool tick() override;
+    void finish_move() override;
+    void request_stop() override;
+    float getCurrentPosition() const override;
+    float getCurrentVelocity() const override;
+    float getProgress() const override;
+    bool isMoveActive() const override;
+    bool isMoveCancelled() const override;
+
+private:
+    StepperController &_controller;
+    FILE *_file;
+    std::chrono::steady_clock::time_point _start;
+    std::atomic<bool> _stop_requested;
+
+    void write(JournalRecordType type, uint8_t flags, float v0 = 0, float v1 = 0, float v2 = 0, float v3 = 0,
+               float v4 = 0);
+
+    void write_state(JournalRecordType type, uint8_t flags);
+};
+
+
+// Drives a fresh StepperController through a journal and checks it does exactly what the recorded one did
+class JournalReplayer {
+public:
+    explicit JournalReplayer(const std::string &path);
+
+    bool isOpen() const;
+
+    size_t getRecordCount() const;
+
+    const JournalRecord &getRecord(size_t index) const;
+
+    JournalReplayResult replay(bool original_speed) const;
+
+private:
+    bool _open;
+    std::vector<JournalRecord> _records;
+};
+
+
+#endif //URBAN_MACHINE_GENERIC_STEPPER_MOTOR_CONTROLLER_SESSIONJOURNAL_H
@@ -0,0 +1,312 @@
+//
+// Created by chu-chu on 10/19/26.
+//
+
+#include "SharedMemoryTelemetry.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+    // shm_open wants a single leading slash
+    std::string shared_memory_name(const std::string &name) {
+        return name.empty() or name[0] != '/' ? "/" + name : name;
+    }
+
+    // Maps the header of the ring currently published under name, nullptr if there is none or it cannot be written
+    TelemetryRingHeader *map_previous_header(const std::string &name) {
+        int fd = shm_open(name.c_str(), O_RDWR, 0);
+        if (fd < 0) {
+            return nullptr;
+        }
+        struct stat shm_stat;
+        void *mapping = MAP_FAILED;
+        if (fstat(fd, &shm_stat) == 0 and shm_stat.st_size >= static_cast<off_t>(sizeof(TelemetryRingHeader))) {
+            mapping = mmap(nullptr, sizeof(TelemetryRingHeader), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        }
+        close(fd);
+        if (mapping == MAP_FAILED) {
+            return nullptr;
+        }
+        TelemetryRingHeader *header = static_cast<TelemetryRingHeader *>(mapping);
+        if (memcmp(header->magic, "SMTR", 4) != 0 or header->version != TELEMETRY_RING_VERSION) {
+            munmap(mapping, sizeof(TelemetryRingHeader));
+            return nullptr;
+        }
+        return header;
+    }
+
+}
+
+/// @brief Constructor for SharedMemoryTelemetryPublisher class. Replaces the shared memory object of that name with
+/// a new one and maps it. The previous object is only unlinked, publishers and readers still mapping it are not
+/// disturbed and readers move to the new one at their next read. This is the only place the publisher makes system
+/// calls.
+/// @param name name of the shared memory object, it shows up as /dev/shm/<name>
+/// @param capacity number of samples of history kept for readers, rounded up to at least 1
+SharedMemoryTelemetryPublisher::SharedMemoryTelemetryPublisher(const std::string &name, uint32_t capacity) :
+        _header(nullptr),
+        _slots(nullptr),
+        _size(0),
+        _capacity(0),
+        _write_count(0) {
+    capacity = capacity > 0 ? capacity : 1;
+    std::string shm_name = shared_memory_name(name);
+    TelemetryRingHeader *previous = map_previous_header(shm_name);
+    uint64_t generation = previous != nullptr ? previous->generation.load(std::memory_order_acquire) + 1 : 1;
+    // Resizing an object someone has mapped would make their accesses past the new end fault, so always start afresh
+    shm_unlink(shm_name.c_str());
+    int fd = shm_open(shm_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) {
+        perror("Failed to open shared memory telemetry");
+        if (previous != nullptr) {
+            munmap(previous, sizeof(TelemetryRingHeader));
+        }
+        return;
+    }
+    size_t size = sizeof(TelemetryRingHeader) + capacity * sizeof(TelemetryRingSlot);
+    if (ftruncate(fd, static_cast<off_t>(size)) < 0) {
+        perror("Failed to size shared memory telemetry");
+        close(fd);
+        if (previous != nullptr) {
+            munmap(previous, sizeof(TelemetryRingHeader));
+        }
+        return;
+    }
+    void *mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        perror("Failed to map shared memory telemetry");
+        if (previous != nullptr) {
+            munmap(previous, sizeof(TelemetryRingHeader));
+        }
+        return;
+    }
+    _size = size;
+    _capacity = capacity;
+    _header = static_cast<TelemetryRingHeader *>(mapping);
+    _slots = reinterpret_cast<TelemetryRingSlot *>(static_cast<unsigned char *>(mapping) +
+                                                   sizeof(TelemetryRingHeader));
+
+    // The new object is zero filled, every slot sequence and the write count start at 0
+    _header->generation.store(generation, std::memory_order_relaxed);
+    _header->version = TELEMETRY_RING_VERSION;
+    _header->capacity = capacity;
+    _header->slot_size = sizeof(TelemetryRingSlot);
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(_header->magic, "SMTR", 4);
+
+    // Readers of the previous object see its generation change and open the new one
+    if (previous != nullptr) {
+        previous->generation.store(generation, std::memory_order_release);
+        munmap(previous, sizeof(TelemetryRingHeader));
+    }
+}
+
+/// @brief Destructor for SharedMemoryTelemetryPublisher class. Unmaps the ring but leaves the shared memory object,
+/// so readers can still go through the history of the last move. Use remove() to delete it.
+SharedMemoryTelemetryPublisher::~SharedMemoryTelemetryPublisher() {
+    if (_header != nullptr) {
+        munmap(_header, _size);
+    }
+}
+
+/// @brief Returns true if the shared memory object was created and mapped
+bool SharedMemoryTelemetryPublisher::isOpen() const {
+    return _header != nullptr;
+}
+
+/// @brief Publishes a sample to the ring, overwriting the oldest one when it is full. Never blocks and makes no
+/// system call.
+/// @param time the time elapsed since the beginning of the motion
+/// @param position the position of the stepper motor
+/// @param velocity the velocity of the stepper motor
+/// @param acceleration the acceleration of the stepper motor
+void SharedMemoryTelemetryPublisher::publish(float time, float position, float velocity, float acceleration) {
+    if (_header == nullptr) {
+        return;
+    }
+    TelemetryRingSlot &slot = _slots[_write_count % _capacity];
+    slot.sequence.store(2 * _write_count + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.time.store(time, std::memory_order_relaxed);
+    slot.position.store(position, std::memory_order_relaxed);
+    slot.velocity.store(velocity, std::memory_order_relaxed);
+    slot.acceleration.store(acceleration, std::memory_order_relaxed);
+    slot.sequence.store(2 * _write_count + 2, std::memory_order_release);
+    ++_write_count;
+    _header->write_count.store(_write_count, std::memory_order_release);
+}
+
+/// @brief Deletes a shared memory object created by a publisher
+/// @param name name of the shared memory object
+/// @return true if it existed and was removed
+bool SharedMemoryTelemetryPublisher::remove(const std::string &name) {
+    return shm_unlink(shared_memory_name(name).c_str()) == 0;
+}
+
+
+/// @brief Constructor for SharedMemoryTelemetryReader class. Maps an existing shared memory object read-only.
+/// @param name name of the shared memory object. isOpen() returns false if no publisher created it yet.
+SharedMemoryTelemetryReader::SharedMemoryTelemetryReader(const std::string &name) :
+        _name(name),
+        _header(nullptr),
+        _slots(nullptr),
+        _size(0),
+        _capacity(0),
+        _generation(0) {
+    map();
+}
+
+SharedMemoryTelemetryReader::~SharedMemoryTelemetryReader() {
+    unmap();
+}
+
+/// @brief Maps the shared memory object and checks that it holds a ring of the capacity its size allows. The
+/// capacity and generation are copied so slots are always indexed against this mapping, whatever a later publisher
+/// writes.
+/// @return true if a ring is mapped
+bool SharedMemoryTelemetryReader::map() {
+    unmap();
+    int fd = shm_open(shared_memory_name(_name).c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat shm_stat;
+    if (fstat(fd, &shm_stat) < 0 or shm_stat.st_size < static_cast<off_t>(sizeof(TelemetryRingHeader))) {
+        close(fd);
+        return false;
+    }
+    size_t size = static_cast<size_t>(shm_stat.st_size);
+    void *mapping = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+    const TelemetryRingHeader *header = static_cast<const TelemetryRingHeader *>(mapping);
+    uint32_t capacity = header->capacity;
+    if (memcmp(header->magic, "SMTR", 4) != 0 or header->version != TELEMETRY_RING_VERSION or capacity == 0 or
+        sizeof(TelemetryRingHeader) + capacity * sizeof(TelemetryRingSlot) > size) {
+        munmap(mapping, size);
+        return false;
+    }
+    _size = size;
+    _capacity = capacity;
+    _generation = header->generation.load(std::memory_order_acquire);
+    _header = header;
+    _slots = reinterpret_cast<const TelemetryRingSlot *>(static_cast<const unsigned char *>(mapping) +
+                                                         sizeof(TelemetryRingHeader));
+    return true;
+}
+
+/// @brief Unmaps the ring, if any
+void SharedMemoryTelemetryReader::unmap() {
+    if (_header != nullptr) {
+        munmap(const_cast<TelemetryRingHeader *>(_header), _size);
+    }
+    _header = nullptr;
+    _slots = nullptr;
+    _size = 0;
+    _capacity = 0;
+    _generation = 0;
+}
+
+/// @brief Opens the name again if a new publisher replaced the mapped ring, or if no ring was mapped yet
+/// @return true if another ring was mapped, the samples read so far belong to the previous publisher
+bool SharedMemoryTelemetryReader::reopen_if_replaced() {
+    if (_header != nullptr and _header->generation.load(std::memory_order_acquire) == _generation) {
+        return false;
+    }
+    return map();
+}
+
+/// @brief Returns true if a publisher's ring is mapped
+bool SharedMemoryTelemetryReader::isOpen() const {
+    return _header != nullptr;
+}
+
+/// @brief Returns the number of samples published so far
+uint64_t SharedMemoryTelemetryReader::getWriteCount() const {
+    return _header != nullptr ? _header->write_count.load(std::memory_order_acquire) : 0;
+}
+
+/// @brief Copies sample number index out of the ring
+/// @return false if the sample is not published yet, or was overwritten before or while it was copied
+bool SharedMemoryTelemetryReader::read_sample(uint64_t index, TelemetrySample &sample) const {
+    const TelemetryRingSlot &slot = _slots[index % _capacity];
+    uint64_t expected = 2 * index + 2;
+    if (slot.sequence.load(std::memory_order_acquire) != expected) {
+        return false;
+    }
+    sample.time = slot.time.load(std::memory_order_relaxed);
+    sample.position = slot.position.load(std::memory_order_relaxed);
+    sample.velocity = slot.velocity.load(std::memory_order_relaxed);
+    sample.acceleration = slot.acceleration.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return slot.sequence.load(std::memory_order_relaxed) == expected;
+}
+
+/// @brief Reads the most recently published sample
+/// @param sample the latest state of the motor
+/// @return false if nothing was published yet
+bool SharedMemoryTelemetryReader::read_latest(TelemetrySample &sample) {
+    reopen_if_replaced();
+    if (_header == nullptr) {
+        return false;
+    }
+    // Retries only when the writer moves on while the sample is being copied
+    while (true) {
+        uint64_t write_count = getWriteCount();
+        if (write_count == 0) {
+            return false;
+        }
+        if (read_sample(write_count - 1, sample)) {
+            return true;
+        }
+    }
+}
+
+/// @brief Appends every sample published since cursor to samples and moves the cursor past them
+/// @param cursor index of the next sample to read, 0 to start from the oldest one still in the ring. A cursor that
+/// fell more than the ring capacity behind skips to the oldest sample still available.
+/// @param samples the vector to append to
+/// @return the number of samples appended
+size_t SharedMemoryTelemetryReader::read_since(uint64_t &cursor, std::vector<TelemetrySample> &samples) {
+    bool reopened = reopen_if_replaced();
+    if (_header == nullptr) {
+        return 0;
+    }
+    uint64_t write_count = getWriteCount();
+    if (reopened or cursor > write_count) {
+        // The publisher restarted, follow it from the beginning
+        cursor = 0;
+    }
+    size_t appended = 0;
+    while (cursor < write_count) {
+        if (write_count - cursor > _capacity) {
+            cursor = write_count - _capacity;
+        }
+        TelemetrySample sample;
+        if (read_sample(cursor, sample)) {
+            samples.push_back(sample);
+            ++appended;
+            ++cursor;
+        }
+        else {
+            // Overwritten while copying, catch up with the writer
+            write_count = getWriteCount();
+            if (cursor >= write_count) {
+                break;
+            }
+            if (write_count - cursor <= _capacity) {
+                ++cursor;
+            }
+        }
+    }
+    return appended;
+}
@@ -0,0 +1,120 @@
+//
+// Created by chu-chu on 10/19/26.
+//
+
+#ifndef URBAN_MACHINE_GENERIC_STEPPER_MOTOR_CONTROLLER_SHAREDMEMORYTELEMETRY_H
+#define URBAN_MACHINE_GENERIC_STEPPER_MOTOR_CONTROLLER_SHAREDMEMORYTELEMETRY_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Layout of the POSIX shared memory object (/dev/shm/<name>), little endian:
+//   TelemetryRingHeader                      64 bytes
+//   TelemetryRingSlot[capacity]              32 bytes each
+// Sample n is stored in slot n % capacity. Its slot sequence is 2n + 1 while the writer fills it and 2n + 2 once it
+// is complete, so a reader knows a copy is valid if the sequence read before and after it is 2n + 2. The single
+// writer never waits for readers and never makes a system call to publish. scripts/shm_telemetry.py reads the same
+// layout. Both sides index slots with the capacity they mapped, never the one in shared memory.
+// A shared memory object is never resized once created. A new publisher unlinks the name and creates a fresh object,
+// so whoever still maps the old one keeps a valid mapping, then sets the generation of the old header to the new
+// one's. Readers compare the generation with the one they mapped and open the name again when it changes.
+
+const uint32_t TELEMETRY_RING_VERSION = 1u;
+
+struct TelemetrySample {
+    float time;
+    float position;
+    float velocity;
+    float acceleration;
+};
+
+struct TelemetryRingHeader {
+    char magic[4];                          // "SMTR"
+    uint32_t version;
+    uint32_t capacity;
+    uint32_t slot_size;
+    std::atomic<uint64_t> write_count;      // number of samples published so far
+    std::atomic<uint64_t> generation;       // bumped on the old object when a publisher replaces it
+    uint64_t reserved[4];
+};
+
+struct TelemetryRingSlot {
+    std::atomic<uint64_t> sequence;
+    std::atomic<float> time;
+    std::atomic<float> position;
+    std::atomic<float> velocity;
+    std::atomic<float> acceleration;
+    uint32_t reserved[2];
+};
+
+static_assert(sizeof(TelemetryRingHeader) == 64, "ring header must stay 64 bytes");
+static_assert(sizeof(TelemetryRingSlot) == 32, "ring slot must stay 32 bytes");
+static_assert(std::atomic<uint64_t>::is_always_lock_free and std::atomic<float>::is_always_lock_free,
+              "shared memory telemetry needs address free atomics");
+
+
+class SharedMemoryTelemetryPublisher {
+public:
+    explicit SharedMemoryTelemetryPublisher(const std::string &name, uint32_t capacity = 4096);
+
+    virtual ~SharedMemoryTelemetryPublisher();
+
+    SharedMemoryTelemetryPublisher(const SharedMemoryTelemetryPublisher &) = delete;
+
+    SharedMemoryTelemetryPublisher &operator=(const SharedMemoryTelemetryPublisher &) = delete;
+
+    bool isOpen() const;
+
+    void publish(float time, float position, float velocity, float acceleration);
+
+    static bool remove(const std::string &name);
+
+private:
+    TelemetryRingHeader *_header;
+    TelemetryRingSlot *_slots;
+    size_t _size;
+    uint32_t _capacity;
+    uint64_t _write_count;
+};
+
+
+class SharedMemoryTelemetryReader {
+public:
+    explicit SharedMemoryTelemetryReader(const std::string &name);
+
+    virtual ~SharedMemoryTelemetryReader();
+
+    SharedMemoryTelemetryReader(const SharedMemoryTelemetryReader &) = delete;
+
+    SharedMemoryTelemetryReader &operator=(const SharedMemoryTelemetryReader &) = delete;
+
+    bool isOpen() const;
+
+    uint64_t getWriteCount() const;
+
+    bool read_latest(TelemetrySample &sample);
+
+    size_t read_since(uint64_t &cursor, std::vector<TelemetrySample> &samples);
+
+private:
+    std::string _name;
+    const TelemetryRingHeader *_header;
+    const TelemetryRingSlot *_slots;
+    size_t _size;
+    uint32_t _capacity;             // copied when mapped, never read back from shared memory
+    uint64_t _generation;
+
+    bool map();
+
+    void unmap();
+
+    bool reopen_if_replaced();
+
+    bool read_sample(uint64_t index, TelemetrySample &sample) const;
+};
+
+
+#endif //URBAN_MACHINE_GENERIC_STEPPER_MOTOR_CONTROLLER_SHAREDMEMORYTELEMETRY_H
@@ -15,23 +15,33 @@
 ///graph plotting if the _graph_real_time_flag and _communication_flag are both set to true.
 StepperController::StepperController(float initial_position, float initial_velocity, float goal_position, float
 max_velocity, float max_acceleration) :
-        _initial_position(initial_position),
-        _initial_velocity(initial_velocity),
-        _goal_position(goal_position),
-        _max_velocity(max_velocity),
-        _max_acceleration(max_acceleration),
+        _segment_count(0),
         _current_position(initial_position),
         _current_velocity(initial_velocity),
-        _distance_and_time_debug_flag(false),
+        _time_step(0.1f),
+        _sampling_mode(SAMPLING_UNIFORM),
+        _position_tolerance(0.01f),
+        _goal_position(goal_position),
+        _max_acceleration(max_acceleration),
+        _stop_requested(false),
+        _progress(0.0f),
+        _move_active(false),
+        _move_cancelled(false),
         _trapezoid_curve_debug_flag(false),
         _graph_real_time_flag(true),
-        _communication_flag(true){
+        _communication_flag(true),
+        _initial_position(initial_position),
+        _initial_velocity(initial_velocity),
+        _max_velocity(max_velocity),
+        _distance_and_time_debug_flag(false),
+        _archive_compression_flag(false),
+        _trajectory_file_path("../data/trajectories.csv"){
 
     //
 
     //Only create a socket if both flags are true
     if(isCommunicationFlag() and isGraphRealTimeFlag()){
-        std::cout<<"Creating Socket"<<std::endl;
+        Logger::instance().log(LOG_INFO, LOG_FORMAT_CREATING_SOCKET);
         struct sockaddr_in serv_addr;
         // Create a socket
         if ((_socket_fd = socket(AF_INET, SOCK_STREAM, 0)) < 0) {
@@ -60,14 +70,24 @@ max_velocity, float max_acceleration) :
 
 
 StepperController::StepperController(float initial_position, float initial_velocity) :
-        _initial_position(initial_position),
-        _initial_velocity(initial_velocity),
+        _segment_count(0),
         _current_position(initial_position),
         _current_velocity(initial_velocity),
-        _distance_and_time_debug_flag(false),
+        _time_step(0.1f),
+        _sampling_mode(SAMPLING_UNIFORM),
+        _position_tolerance(0.01f),
+        _stop_requested(false),
+        _progress(0.0f),
+        _move_active(false),
+        _move_cancelled(false),
         _trapezoid_curve_debug_flag(false),
         _graph_real_time_flag(false),
-        _communication_flag(false){}
+        _communication_flag(false),
+        _initial_position(initial_position),
+        _initial_velocity(initial_velocity),
+        _distance_and_time_debug_flag(false),
+        _archive_compression_flag(false),
+        _trajectory_file_path("../data/trajectories.csv"){}
 
 StepperController::~StepperController() {
 
@@ -97,59 +117,199 @@ float StepperController::getCurrentVelocity() const {
     return _current_velocity;
 }
 
+/// @brief Getter method for the current acceleration of the stepper motor
+///@return the acceleration applied from the current sample until the next one
+float StepperController::getCurrentAcceleration() const {
+    return _current_acceleration;
+}
+
+/// @brief Getter method for the time of the current sample
+///@return the time elapsed since the beginning of the move
+float StepperController::getTimeElapsed() const {
+    return _time_elapsed;
+}
+
+/// @brief Getter method for the position moves start from
+float StepperController::getInitialPosition() const {
+    return _initial_position;
+}
+
+/// @brief Getter method for the velocity moves start with
+float StepperController::getInitialVelocity() const {
+    return _initial_velocity;
+}
+
+/// @brief Getter method for the goal position set by the constructor or set_goal()
+float StepperController::getGoalPosition() const {
+    return _goal_position;
+}
+
+/// @brief Getter method for the max velocity set by the constructor or set_goal()
+float StepperController::getMaxVelocity() const {
+    return _max_velocity;
+}
+
+/// @brief Getter method for the max acceleration set by the constructor or set_goal()
+float StepperController::getMaxAcceleration() const {
+    return _max_acceleration;
+}
+
 /// @brief This function generates a trajectory for a stepper motor controller to move from its initial position
 /// the goal position with given maximum velocity and acceleration. The function performs pre-motion sanity checks
 ///to ensure that the motion is feasible. If the motion is not feasible, the function returns without generating a
 /// trajectory.
-/// @details The function calculates the total distance to be covered, the remaining distance to the goal position,
-///the acceleration time and distance, deceleration time and distance, cruising distance and time, and total time for
-///the motion. It then generates the trajectory by computing the position and velocity of the motor at each time step.
-///The generated trajectory is written to a file named "trajectories.csv" in the "data" directory.
+/// @details The move runs synchronously on the calling thread: begin_move() plans it, tick() is called until the
+///motion is over and finish_move() writes the last sample. Ticks are spaced by getRealTimeTickPeriod(). Use
+///MoveExecutor to run moves asynchronously.
 void StepperController::step() {
+    if (!begin_move()) {
+        return;
+    }
+    std::chrono::milliseconds tick_period = getRealTimeTickPeriod();
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now();
+    while (tick()) {
+        if (tick_period.count() > 0) {
+            deadline += tick_period;
+            std::this_thread::sleep_until(deadline);
+        }
+    }
+    finish_move();
+}
+
+/// @brief Returns the wall clock time step() leaves between two ticks: 100 ms while samples are sent to the plot
+/// socket, so the graph is drawn in real time, and 0 otherwise. tick() itself never waits, a MoveExecutor paces the
+/// moves it runs with its own tick period.
+std::chrono::milliseconds StepperController::getRealTimeTickPeriod() const {
+    return isCommunicationFlag() and isGraphRealTimeFlag() ? std::chrono::milliseconds(100)
+                                                           : std::chrono::milliseconds(0);
+}
+
+/// @brief Plans a move without generating any samples. The function performs pre-motion sanity checks to ensure that
+/// the motion is feasible.
+/// @details The function calculates the total distance to be covered, the remaining distance to the goal position,
+///the peak velocity, the acceleration time and distance, deceleration time and distance, cruising distance and time,
+///and total time for the motion. These are turned into the motion segments tick() samples. It then opens the
+///trajectory file (by default "trajectories.csv" in the "data" directory) that tick() writes every sample to.
+/// @return true if the move is feasible and ticks can start, false otherwise
+bool StepperController::begin_move() {
+    _stop_requested.store(false);
+    _move_cancelled = false;
+    _progress.store(0.0f);
     _sanity_check_flag = pre_motion_sanity_checks(_initial_position, _initial_velocity,
                                                   _goal_position, _max_velocity,
                                                   _max_acceleration);
+    if (_sanity_check_flag and !(_time_step > 0)) {
+        Logger::instance().log(LOG_ERROR, LOG_FORMAT_TIME_STEP_NOT_POSITIVE);
+        _sanity_check_flag = false;
+    }
+    if (_sanity_check_flag and _sampling_mode == SAMPLING_ADAPTIVE and !(_position_tolerance > 0)) {
+        Logger::instance().log(LOG_ERROR, LOG_FORMAT_TOLERANCE_NOT_POSITIVE);
+        _sanity_check_flag = false;
+    }
     if (!_sanity_check_flag) {
-        return;
+        _move_active = false;
+        return false;
     }
 
-    float total_distance = calculate_total_distance();
-    float remaining_distance = calculate_remaining_distance();
+    _current_position = _initial_position;
+    _current_velocity = _initial_velocity;
+    _total_distance = calculate_total_distance();
+    _remaining_distance = calculate_remaining_distance();
+
+    float peak_velocity = calculate_peak_velocity(_total_distance);
 
-    float acceleration_time = calculate_acceleration_time();
+    float acceleration_time = calculate_acceleration_time(peak_velocity);
     float acceleration_distance = calculate_acceleration_distance(acceleration_time);
 
-    float deceleration_time = calculate_deceleration_time();
+    float deceleration_time = calculate_deceleration_time(peak_velocity);
     float deceleration_distance = calculate_deceleration_distance(deceleration_time);
 
-    float cruising_distance = calculate_cruising_distance(total_distance, acceleration_distance, deceleration_distance);
-    float cruising_time = calculate_cruising_time(cruising_distance);
+    float cruising_distance = calculate_cruising_distance(_total_distance, acceleration_distance,
+                                                          deceleration_distance);
+    float cruising_time = calculate_cruising_time(cruising_distance, peak_velocity);
 
     // Compute total time and check if it's feasible
     float total_time = calculate_total_time(acceleration_time, cruising_time, deceleration_time);
 
-    float distance_covered = total_distance - remaining_distance;
+    _distance_covered = _total_distance - _remaining_distance;
 
     if (_distance_and_time_debug_flag) {
         debug_print_motion_parameters(acceleration_time, acceleration_distance,
-                                      deceleration_time, deceleration_distance, total_time, total_distance,
+                                      deceleration_time, deceleration_distance, total_time, _total_distance,
                                       cruising_time,
                                       cruising_distance);
     }
 
-    std::ofstream trajectory_file("../data/trajectories.csv");
-    if (!trajectory_file) {
-        std::cerr << "Failed to open file for writing!" << std::endl;
+    _sample_index = 0;
+    _sample_time = 0.0;
+    _time_elapsed = 0.0;
+    _segment_count = 0;
+    append_motion_segment(acceleration_time, _max_acceleration);
+    append_motion_segment(cruising_time, 0);
+    append_motion_segment(deceleration_time, -_max_acceleration);
+    _end_position = _goal_position;
+
+    if (!_trajectory_file_path.empty()) {
+        _trajectory_file.open(_trajectory_file_path);
+        if (!_trajectory_file) {
+            Logger::instance().log(LOG_ERROR, LOG_FORMAT_TRAJECTORY_FILE_OPEN_FAILED);
+        }
     }
 
-    float time_step = 0.1;
-    float time_elapsed = 0.0;
-    _current_acceleration = _max_acceleration;
+    sample_motion(_sample_time);
+    _trajectory_columns.clear();
+    _move_active = true;
+    return true;
+}
 
+/// @brief Writes the last sample of the move, closes the trajectory file and, if an archive path is set, appends the
+/// move as a new run to the columnar trajectory archive.
+void StepperController::finish_move() {
+    update_trajectory(_trajectory_file, _time_elapsed, _current_position, _current_velocity,
+                      _current_acceleration);
+    if (_trajectory_file.is_open()) {
+        _trajectory_file.close();
+    }
+    _move_active = false;
+    _progress.store(1.0f);
+
+    if (!_archive_path.empty()) {
+        // Adaptive runs have no fixed time step, they are stored with a time step of 0
+        TrajectoryRunInfo run_info = {_initial_position, _initial_velocity, _goal_position, _max_velocity,
+                                      _max_acceleration, _sampling_mode == SAMPLING_UNIFORM ? _time_step : 0.0f};
+        TrajectoryArchiveWriter archive(_archive_path, _archive_compression_flag);
+        if (!archive.append_run(run_info, _trajectory_columns)) {
+            Logger::instance().log(LOG_ERROR, LOG_FORMAT_ARCHIVE_APPEND_FAILED);
+        }
+    }
+}
+
+/// @brief Asks the running move to stop. Safe to call from any thread.
+/// @details The move is not aborted on the spot, the following ticks decelerate the motor at max acceleration until
+/// its velocity reaches 0, after which tick() returns false and isMoveCancelled() returns true.
+void StepperController::request_stop() {
+    _stop_requested.store(true);
+}
+
+/// @brief Returns true once request_stop() has been called for the current move.
+bool StepperController::isStopRequested() const {
+    return _stop_requested.load();
+}
+
+/// @brief Returns the fraction of the planned move time elapsed so far. Safe to call from any thread.
+/// @return 0 before the first tick, 1 once the move is finished or stopped
+float StepperController::getProgress() const {
+    return _progress.load();
+}
+
+/// @brief Returns true between a successful begin_move() and the end of the motion.
+bool StepperController::isMoveActive() const {
+    return _move_active;
+}
 
-    generate_trajectory(total_time, time_elapsed, acceleration_time, cruising_time, time_step, trajectory_file,
-                        remaining_distance, distance_covered, total_distance);
-    trajectory_file.close();
+/// @brief Returns true if the last move ended early because of request_stop().
+bool StepperController::isMoveCancelled() const {
+    return _move_cancelled;
 }
 
 
@@ -167,14 +327,9 @@ void StepperController::debug_print_motion_parameters(float acceleration_time, f
                                                       float deceleration_time, float deceleration_distance,
                                                       float total_time, float total_distance, float cruising_time,
                                                       float cruising_distance) const {
-    std::cout << "acceleration_time = " << acceleration_time << std::endl;
-    std::cout << "acceleration_distance = " << acceleration_distance << std::endl;
-    std::cout << "deceleration_time = " << deceleration_time << std::endl;
-    std::cout << "deceleration_distance = " << deceleration_distance << std::endl;
-    std::cout << "total_time = " << total_time << std::endl;
-    std::cout << "total_distance = " << total_distance << std::endl;
-    std::cout << "cruise_time = " << cruising_time << std::endl;
-    std::cout << "cruising_distance = " << cruising_distance << std::endl;
+    Logger::instance().log(LOG_DEBUG, LOG_FORMAT_MOTION_PARAMETERS, acceleration_time, acceleration_distance,
+                           deceleration_time, deceleration_distance, total_time, total_distance, cruising_time,
+                           cruising_distance);
 }
 
 /// @brief Performs various sanity checks before starting a motion and returns true if they all pass, false otherwise
@@ -187,41 +342,45 @@ void StepperController::debug_print_motion_parameters(float acceleration_time, f
 bool StepperController::pre_motion_sanity_checks(float initial_position, float initial_velocity, float goal_position,
                                                  float max_velocity, float max_acceleration) {
     if (max_velocity == 0.0) {
-        std::cerr << "Error, max velocity is 0. Motor will cruise forever" << std::endl;
+        Logger::instance().log(LOG_ERROR, LOG_FORMAT_MAX_VELOCITY_ZERO);
         return false;
     }
     if (max_velocity > 0 and initial_velocity > 0 and max_velocity < initial_velocity) {
-        std::cerr << "Error, max velocity cannot be less than initial velocity" << std::endl;
+        Logger::instance().log(LOG_ERROR, LOG_FORMAT_MAX_VELOCITY_BELOW_INITIAL);
         return false;
     }
     if (max_velocity > 0 and initial_velocity < 0 and goal_position < initial_position) {
-        std::cerr << "Error, it's not possible to hit a goal position less than the initial position with a "
-                     "positive max velocity" << std::endl;
+        Logger::instance().log(LOG_ERROR, LOG_FORMAT_GOAL_BEHIND_WITH_POSITIVE_MAX_VELOCITY);
         return false;
     }
     if (max_velocity < 0 and initial_velocity < 0 and std::fabs(max_velocity) < std::fabs(initial_velocity)) {
-        std::cerr << "Error, both initial and goal velocities are negative but the max velocity is less than the "
-                     "initial velocity since we're moving in the other direction" <<
-                  std::endl;
+        Logger::instance().log(LOG_ERROR, LOG_FORMAT_NEGATIVE_MAX_VELOCITY_BELOW_INITIAL);
         return false;
     }
     if (max_acceleration < 0.0) {
-        std::cerr << "Max acceleration is cannot be negative." << std::endl;
+        Logger::instance().log(LOG_ERROR, LOG_FORMAT_NEGATIVE_MAX_ACCELERATION);
         return false;
     }
 
     if (max_acceleration == 0 or max_velocity == 0) {
-        std::cerr << "Potential Division by Zero Error, max_acceleration or max_velocity is zero." << std::endl;
+        Logger::instance().log(LOG_ERROR, LOG_FORMAT_DIVISION_BY_ZERO);
         return false;
     }
     if (initial_position == goal_position) {
-        std::cerr << "Error, the motor won't move, initial_position and goal_position are the same"
-                  << std::endl;
+        Logger::instance().log(LOG_ERROR, LOG_FORMAT_GOAL_EQUALS_INITIAL);
+        return false;
+    }
+    if (goal_position < initial_position) {
+        Logger::instance().log(LOG_ERROR, LOG_FORMAT_GOAL_BEHIND_INITIAL);
+        return false;
+    }
+    if (initial_velocity > 0 and
+        initial_velocity * initial_velocity / (2 * max_acceleration) > goal_position - initial_position) {
+        Logger::instance().log(LOG_ERROR, LOG_FORMAT_CANNOT_STOP_AT_GOAL);
         return false;
     }
     if (goal_position < 0 or max_velocity < 0 or max_acceleration < 0) {
-        std::cerr << "Error, this class doesn't handle negative goal positions, max velocities or max accelerations"
-                  << std::endl;
+        Logger::instance().log(LOG_ERROR, LOG_FORMAT_NEGATIVE_PARAMETERS);
         return false;
     }
     return true;
@@ -235,13 +394,8 @@ bool StepperController::pre_motion_sanity_checks(float initial_position, float i
 /// @param distance_covered the distance covered by the stepper motor so far
 void StepperController::print_acceleration_debug_values(float &time_elapsed, float &remaining_distance, float &
 distance_covered) {
-    std::cout << "\naccelerating " << time_elapsed << std::endl;
-    std::cout << "accelerating current_position = " << _current_position << std::endl;
-    std::cout << "accelerating current_velocity = " << _current_velocity << std::endl;
-    std::cout << "accelerating current_acceleration = " << _current_acceleration << std::endl;
-    std::cout << "remaining_distance = " << remaining_distance << std::endl;
-    std::cout << "distance_covered = " << distance_covered << std::endl;
-
+    Logger::instance().log(LOG_DEBUG, LOG_FORMAT_ACCELERATING_VALUES, time_elapsed, _current_position, _current_velocity,
+                           _current_acceleration, remaining_distance, distance_covered);
 }
 
 
@@ -252,12 +406,8 @@ distance_covered) {
 /// @param distance_covered the distance covered by the stepper motor so far
 void StepperController::print_cruising_debug_values(float &time_elapsed, float &remaining_distance,
                                                     float &distance_covered) {
-    std::cout << "\ncruising " << time_elapsed << std::endl;
-    std::cout << "cruising current_position = " << _current_position << std::endl;
-    std::cout << "cruising current_velocity = " << _current_velocity << std::endl;
-    std::cout << "cruising current_acceleration = " << _current_acceleration << std::endl;
-    std::cout << "cruising remaining_distance = " << remaining_distance << std::endl;
-    std::cout << "distance_covered = " << distance_covered << std::endl;
+    Logger::instance().log(LOG_DEBUG, LOG_FORMAT_CRUISING_VALUES, time_elapsed, _current_position, _current_velocity,
+                           _current_acceleration, remaining_distance, distance_covered);
 }
 
 /// @brief This method prints out the various deceleration values to make debugging the deceleration stage easier, it is
@@ -267,13 +417,8 @@ void StepperController::print_cruising_debug_values(float &time_elapsed, float &
 /// @param distance_covered the distance covered by the stepper motor so far
 void StepperController::print_deceleration_debug_values(float &time_elapsed, float &remaining_distance,
                                                         float &distance_covered) {
-    std::cout << "\ndecelerating " << time_elapsed << std::endl;
-    std::cout << "decelerating current_position = " << _current_position << std::endl;
-    std::cout << "decelerating current_velocity = " << _current_velocity << std::endl;
-    std::cout << "decelerating current_acceleration = " << _current_acceleration << std::endl;
-    std::cout << "decelerating remaining_distance = " << remaining_distance << std::endl;
-    std::cout << "distance_covered = " << distance_covered << std::endl;
-
+    Logger::instance().log(LOG_DEBUG, LOG_FORMAT_DECELERATING_VALUES, time_elapsed, _current_position, _current_velocity,
+                           _current_acceleration, remaining_distance, distance_covered);
 }
 
 ///@brief Getter function for _distance_and_time_debug_flag member variable.
@@ -290,66 +435,100 @@ void StepperController::setDistanceAndTimeDebugFlag(bool distanceAndTimeDebugFla
 
 
 
-/// @brief Accelerates the stepper motor given the current velocity, position and acceleration, and the maximum
-/// acceleration
-/// @param current_velocity the current velocity of the stepper motor
-/// @param current_position the current position of the stepper motor
-/// @param current_acceleration the current acceleration of the stepper motor
-/// @param max_acceleration the maximum deceleration that can be applied to the motor
-/// @param time_step the amount of time that has elapsed since the last
-/// @details The current acceleration is set to the max
-/// acceleration, the formula for current velocity is the first equation of motion V = U + a*t. or current velocity =
-/// initial velocity + acceleration * time. Since the current_velocity is the initial velocity originally, we simply
-/// add a*t at each time step. Position is the second equation of motion S = u*t + 0.5 * a*t^2. Like current velocity
-/// we increase our position at each time step.
-void StepperController::accelerate(float &current_velocity, float &max_velocity, float &current_position, float &
-current_acceleration, float max_acceleration, float time_step) {
-    current_acceleration = max_acceleration;
-    current_velocity += current_acceleration * time_step;
-    current_velocity = std::min(max_velocity, current_velocity);
+/// @brief Appends a constant acceleration segment to the motion profile. The segment starts where the previous one
+/// ends, or at the current state of the motor if it is the first one.
+/// @param duration how long the segment lasts, in seconds
+/// @param acceleration the constant acceleration over the segment
+/// @details The start state of every segment is computed once, in double precision, from the exact end state of the
+/// previous segment: V = U + a*t and S = u*t + 0.5 * a*t^2 over the whole previous segment.
+void StepperController::append_motion_segment(double duration, double acceleration) {
+    MotionSegment segment;
+    segment.duration = std::fmax(0.0, duration);
+    segment.acceleration = acceleration;
+    if (_segment_count == 0) {
+        segment.start_time = _sample_time;
+        segment.start_position = _current_position;
+        segment.start_velocity = _current_velocity;
+    }
+    else {
+        const MotionSegment &previous = _motion_segments[_segment_count - 1];
+        segment.start_time = previous.start_time + previous.duration;
+        segment.start_position = previous.start_position + previous.start_velocity * previous.duration +
+                                 0.5 * previous.acceleration * previous.duration * previous.duration;
+        segment.start_velocity = previous.start_velocity + previous.acceleration * previous.duration;
+    }
+    _motion_segments[_segment_count++] = segment;
+    _total_time = segment.start_time + segment.duration;
+    _segment_index = 0;
+}
+
+/// @brief Sets the current position, velocity and acceleration of the motor to their exact values at a point in time
+/// @param time the time since the beginning of the motion, samples have to be taken in increasing order
+/// @details A tick that spans a phase boundary is split at the boundary: the segment index is moved past every segment
+/// that ends before time, and the state is evaluated with the equations of motion from the start of the segment
+/// containing time. Nothing is accumulated from tick to tick, so the time step has no influence on accuracy. At or
+/// past the total time the motor is at rest on the end position, which is exactly the goal position for a completed
+/// move.
+void StepperController::sample_motion(double time) {
+    if (time >= _total_time) {
+        _current_position = static_cast<float>(_end_position);
+        _current_velocity = 0;
+        _current_acceleration = 0;
+        return;
+    }
+    while (_segment_index + 1 < _segment_count and
+           time >= _motion_segments[_segment_index].start_time + _motion_segments[_segment_index].duration) {
+        ++_segment_index;
+    }
+    const MotionSegment &segment = _motion_segments[_segment_index];
+    double segment_time = time - segment.start_time;
+    _current_position = static_cast<float>(segment.start_position + segment.start_velocity * segment_time +
+                                           0.5 * segment.acceleration * segment_time * segment_time);
+    _current_velocity = static_cast<float>(segment.start_velocity + segment.acceleration * segment_time);
+    _current_acceleration = static_cast<float>(segment.acceleration);
+}
+
+/// @brief Returns the time of the sample following the current one
+/// @return the next sample time, never past the total time so the last sample lands exactly on it
+/// @details In SAMPLING_UNIFORM mode samples are taken every time step, at index * time_step rather than by adding up
+/// time steps. In SAMPLING_ADAPTIVE mode every phase breakpoint is a sample, cruising segments get no samples in
+/// between, and accelerating segments are split into equal intervals short enough for straight lines between samples
+/// to stay within the position tolerance. Over an interval h the chord of S = u*t + 0.5 * a*t^2 deviates from it by
+/// at most |a| * h^2 / 8, so h = sqrt(8 * tolerance / |a|).
+double StepperController::next_sample_time() {
+    if (_sampling_mode == SAMPLING_UNIFORM) {
+        ++_sample_index;
+        return std::fmin(static_cast<double>(_sample_index) * _time_step, _total_time);
+    }
 
-    current_position += current_velocity * time_step + 0.5 * current_acceleration * std::pow(time_step, 2);
+    const MotionSegment &segment = _motion_segments[_segment_index];
+    double segment_end = segment.start_time + segment.duration;
+    double next_time = segment_end;
+    if (segment.acceleration != 0 and segment.duration > 0) {
+        double max_interval = std::sqrt(8.0 * _position_tolerance / std::fabs(segment.acceleration));
+        double interval_count = std::ceil(segment.duration / max_interval);
+        double interval = segment.duration / interval_count;
+        double interval_index = std::round((_sample_time - segment.start_time) / interval) + 1;
+        if (interval_index < interval_count) {
+            next_time = segment.start_time + interval_index * interval;
+        }
+    }
+    return std::fmin(next_time, _total_time);
 }
 
-
-/// @brief This function is responsible for updating the position, velocity and acceleration of the motor during the cruise phase.
-/// @param current_velocity the current velocity of the stepper motor
-/// @param current_position the current position of the stepper motor
-/// @param current_acceleration the current acceleration of the stepper motor
-/// @param max_acceleration the maximum deceleration that can be applied to the motor
-/// @param time_step the amount of time that has elapsed since the last
-/// @details The current acceleration is set to zero since
-/// the motor is moving at it's max velocity. The current velocity is set to the maximum velocity and the current
-/// position the second equation of motion. However, a is 0 so S = u*t + 0.5*a*t^2 becomes S = u*t. We update the
-/// position at every time step
-void StepperController::cruise(float &current_velocity, float &current_position, float max_velocity, float &
-current_acceleration, float time_step) {
-    current_acceleration = 0;
-    current_velocity = max_velocity;
-    current_position += current_velocity * time_step;
+/// @brief Replaces the rest of the motion profile with a deceleration to a stop after request_stop()
+/// @details The acceleration opposes the current velocity at max acceleration, the motor comes to rest after
+/// |v| / a seconds, u^2 / (2a) further along.
+void StepperController::plan_stop() {
+    double velocity = _current_velocity;
+    double stopping_time = std::fabs(velocity) / _max_acceleration;
+    _segment_count = 0;
+    append_motion_segment(stopping_time, velocity > 0 ? -_max_acceleration : _max_acceleration);
+    _end_position = _current_position + 0.5 * velocity * stopping_time;
 }
 
-
-
-/// @brief Decelerates the stepper motor given the current velocity, position and acceleration, and the maximum acceleration
-/// @param current_velocity the current velocity of the stepper motor
-/// @param current_position the current position of the stepper motor
-/// @param current_acceleration the current acceleration of the stepper motor
-/// @param max_acceleration the maximum deceleration that can be applied to the motor
-/// @param time_step the amount of time that has elapsed since the last update
-/// @details The current acceleration is set to the
-/// negative of max acceleration since the motor is slowing down, the formula for current velocity is the first equation
-/// of motion V = U + a*t. or current velocity = initial velocity + acceleration * time. Since the current_velocity is
-/// the initial velocity originally, we simply add a*t at each time step. Position is the second equation of motion
-/// S = u*t + 0.5 * a*t^2. Like current velocity we increase our position at each time step.
-void StepperController::decelerate(float &current_velocity, float &current_position, float &current_acceleration,
-                                   float max_acceleration, float time_step) {
-    current_acceleration = -max_acceleration;
-    current_velocity += current_acceleration * time_step;
-    current_position += current_velocity * time_step + 0.5 * current_acceleration * std::pow(time_step, 2);
-}
-
-/// @brief Updates the trajectory by appending current time, position, velocity and acceleration to the provided output file
+/// @brief Updates the trajectory by appending current time, position, velocity and acceleration to the provided output
+/// file, to the archive columns when an archive path is set and to the shared memory telemetry ring when it is enabled
 /// @param trajectory_file the output file stream to write to
 /// @param time_elapsed the time elapsed since the beginning of the motion
 /// @param current_position the current position of the stepper motor
@@ -359,69 +538,64 @@ void StepperController::decelerate(float &current_velocity, float &current_posit
 void StepperController::update_trajectory(std::ofstream &trajectory_file, float &time_elapsed,
                                           float &current_position, float &current_velocity,
                                           float &current_acceleration) {
-    trajectory_file << time_elapsed << ", " << current_position << ", " << current_velocity << ", "
-                    << current_acceleration << std::endl;
-}
-
-/// @brief This method computes and writes the time steps, positions, velocities and accelerations of the stepper motor
-/// to a csv file. The while loop runs while the time elapsed is less than the total time to get to the stepper motor's
-/// goal position. If the _trapezoid_curve_debug_flag is toggled to true, debug messages are printed to screen
-/// @param total_time the total time taken to complete the trajectory.
-/// @param time_elapsed the time elapsed since the start of the trajectory.
-/// @param acceleration_time the time taken to accelerate the stepper motor.
-/// @param cruising_time the time taken to cruise the stepper motor.
-/// @param time_step the time step at which the stepper motor is updated.
-/// @param trajectory_file the file to write the updated trajectory.
-/// @param remaining_distance the distance remaining for the stepper motor to reach the goal position.
-/// @param distance_covered the total distance covered by the stepper motor.
-/// @param total_distance the total distance to be covered by the stepper motor.
-void StepperController::generate_trajectory(float &total_time, float &time_elapsed, float &acceleration_time, float &
-cruising_time, float &time_step, std::ofstream &trajectory_file, float &
-remaining_distance, float &distance_covered, float &total_distance) {
-    while (time_elapsed <= total_time) {
-        if (time_elapsed < acceleration_time) {
-            if (_trapezoid_curve_debug_flag) {
-                print_acceleration_debug_values(time_elapsed, remaining_distance, distance_covered);
-            }
-            update_trajectory(trajectory_file, time_elapsed, _current_position, _current_velocity,
-                              _current_acceleration);
-            accelerate(_current_velocity, _max_velocity, _current_position, _current_acceleration, _max_acceleration,
-                       time_step);
-
-        }
-        else if (time_elapsed < acceleration_time + cruising_time) {
-            if (_trapezoid_curve_debug_flag) {
-                print_cruising_debug_values(time_elapsed, remaining_distance, distance_covered);
-            }
-
-            update_trajectory(trajectory_file, time_elapsed, _current_position, _current_velocity,
-                              _current_acceleration);
-            cruise(_current_velocity, _current_position, _max_velocity, _current_acceleration, time_step);
+    if (trajectory_file.is_open()) {
+        trajectory_file << time_elapsed << ", " << current_position << ", " << current_velocity << ", "
+                        << current_acceleration << std::endl;
+    }
+    if (!_archive_path.empty()) {
+        _trajectory_columns.append(time_elapsed, current_position, current_velocity, current_acceleration);
+    }
+    if (_telemetry_publisher) {
+        _telemetry_publisher->publish(time_elapsed, current_position, current_velocity, current_acceleration);
+    }
+}
 
+/// @brief This method computes and writes a single time step of the move started by begin_move(). It returns false
+/// once the sample at the total time to get to the stepper motor's goal position has been reached, or once the motor
+/// has come to a stop after request_stop(). If the _trapezoid_curve_debug_flag is toggled to true, debug messages are
+/// printed to screen
+/// @return true if a sample was generated and the motion continues, false if the move is over
+/// @details The time of the next sample is chosen by next_sample_time() according to the sampling mode.
+bool StepperController::tick() {
+    if (!_move_active) {
+        return false;
+    }
+    if (_stop_requested.load() and !_move_cancelled) {
+        _move_cancelled = true;
+        plan_stop();
+    }
+    if (_sample_time >= _total_time) {
+        _move_active = false;
+        return false;
+    }
 
-            }
+    if (_trapezoid_curve_debug_flag) {
+        if (_current_acceleration > 0) {
+            print_acceleration_debug_values(_time_elapsed, _remaining_distance, _distance_covered);
+        }
+        else if (_current_acceleration == 0) {
+            print_cruising_debug_values(_time_elapsed, _remaining_distance, _distance_covered);
+        }
         else {
-            if (_trapezoid_curve_debug_flag) {
-                print_deceleration_debug_values(time_elapsed, remaining_distance, distance_covered);
-            }
-            update_trajectory(trajectory_file, time_elapsed, _current_position, _current_velocity,
-                              _current_acceleration);
-            decelerate(_current_velocity, _current_position, _current_acceleration, _max_acceleration, time_step);
-
-            }
-        //Only send data over socket if both flags are true
-        if (isCommunicationFlag() and isGraphRealTimeFlag()){
-            send_data(time_elapsed);
+            print_deceleration_debug_values(_time_elapsed, _remaining_distance, _distance_covered);
         }
-
-
-        // compute remaining distance
-        remaining_distance = _goal_position - _current_position;
-        distance_covered = total_distance - remaining_distance;
-        time_elapsed += time_step;
     }
-    update_trajectory(trajectory_file, time_elapsed, _current_position, _current_velocity,
+    update_trajectory(_trajectory_file, _time_elapsed, _current_position, _current_velocity,
                       _current_acceleration);
+    //Only send data over socket if both flags are true
+    if (isCommunicationFlag() and isGraphRealTimeFlag()){
+        send_data(_time_elapsed);
+    }
+
+    _sample_time = next_sample_time();
+    sample_motion(_sample_time);
+    _time_elapsed = static_cast<float>(_sample_time);
+
+    // compute remaining distance
+    _remaining_distance = _goal_position - _current_position;
+    _distance_covered = _total_distance - _remaining_distance;
+    _progress.store(static_cast<float>(std::fmin(1.0, _sample_time / _total_time)));
+    return true;
 }
 
 /// @brief Getter method for _sanity_check_flag.
@@ -442,10 +616,28 @@ float StepperController::calculate_total_distance() {
     return std::fabs(_goal_position - _initial_position);
 }
 
-/// @brief Calculates the time it takes to accelerate from the initial velocity to the maximum velocity.
+/// @brief Calculates the highest velocity of the move. This is the max velocity when the motor has room to reach it
+/// before it has to decelerate, otherwise the velocity at which the acceleration and deceleration phases meet.
+/// @param total_distance The total distance to be traveled as a float value.
+/// @return The peak velocity as a float value.
+/// @details With only acceleration and deceleration the distance is (vp^2 - u^2) / 2a + vp^2 / 2a, which gives
+/// vp = sqrt(a * distance + u^2 / 2).
+float StepperController::calculate_peak_velocity(float total_distance) {
+    double acceleration = _max_acceleration;
+    double initial_velocity = _initial_velocity;
+    double peak_velocity = std::sqrt(acceleration * total_distance + 0.5 * initial_velocity * initial_velocity);
+    if (peak_velocity >= _max_velocity) {
+        return _max_velocity;
+    }
+    Logger::instance().log(LOG_WARNING, LOG_FORMAT_MAX_VELOCITY_NOT_REACHED, peak_velocity);
+    return static_cast<float>(peak_velocity);
+}
+
+/// @brief Calculates the time it takes to accelerate from the initial velocity to the peak velocity.
+/// @param peak_velocity The peak velocity as a float value.
 /// @return The acceleration time as a float value.
-float StepperController::calculate_acceleration_time() {
-    return std::fabs((_max_velocity - _initial_velocity) / _max_acceleration);
+float StepperController::calculate_acceleration_time(float peak_velocity) {
+    return std::fabs((peak_velocity - _initial_velocity) / _max_acceleration);
 }
 
 /// @brief Calculates the distance traveled during acceleration given the acceleration time.
@@ -455,10 +647,11 @@ float StepperController::calculate_acceleration_distance(float acceleration_time
     return _initial_velocity * acceleration_time + 0.5 * _max_acceleration * std::pow(acceleration_time, 2);
 }
 
-/// @brief Calculates the time it takes to decelerate from the maximum velocity to 0 velocity.
+/// @brief Calculates the time it takes to decelerate from the peak velocity to 0 velocity.
+/// @param peak_velocity The peak velocity as a float value.
 /// @return The deceleration time as a float value.
-float StepperController::calculate_deceleration_time() {
-    return std::fabs(_max_velocity / _max_acceleration);
+float StepperController::calculate_deceleration_time(float peak_velocity) {
+    return std::fabs(peak_velocity / _max_acceleration);
 }
 
 /// @brief Calculates the distance traveled during deceleration given the deceleration time.
@@ -468,27 +661,23 @@ float StepperController::calculate_deceleration_distance(float deceleration_time
     return 0.5 * _max_acceleration * std::pow(deceleration_time, 2);
 }
 
-/// @brief Calculates the distance that will be traveled while cruising at maximum velocity.
+/// @brief Calculates the distance that will be traveled while cruising at peak velocity.
 /// @param total_distance The total distance to be traveled as a float value.
 /// @param acceleration_distance The distance traveled during acceleration as a float value.
 /// @param deceleration_distance The distance traveled during deceleration as a float value.
-/// @return The cruising distance as a float value.
+/// @return The cruising distance as a float value, 0 when the profile is triangular.
 float StepperController::calculate_cruising_distance(float total_distance, float acceleration_distance,
                                                      float deceleration_distance) {
     float cruising_distance = total_distance - acceleration_distance - deceleration_distance;
-    if (cruising_distance == 0.0) {
-        std::cout << "WARNING: Cannot follow trapezoidal velocity curve with the given parameters. Cruising distance "
-                     "is 0"
-                  << std::endl;
-    }
     return std::fmax(0, cruising_distance);
 }
 
-/// @brief Calculates the time spent cruising at maximum velocity.
+/// @brief Calculates the time spent cruising at peak velocity.
 /// @param cruising_distance The cruising distance as a float value.
+/// @param peak_velocity The peak velocity as a float value.
 /// @return The cruising time as a float value.
-float StepperController::calculate_cruising_time(float cruising_distance){
-    return cruising_distance / _max_velocity;
+float StepperController::calculate_cruising_time(float cruising_distance, float peak_velocity){
+    return cruising_distance / peak_velocity;
 }
 
 /// @brief Calculates the remaining distance to the goal position.
@@ -504,9 +693,7 @@ float StepperController::calculate_remaining_distance(){
 /// @return
 float StepperController::calculate_total_time(float acceleration_time, float cruising_time, float deceleration_time){
     if (acceleration_time + cruising_time + deceleration_time <= 0) {
-        std::cerr << "WARNING: Cannot follow trapezoidal velocity curve with the given parameters. total_time is less"
-                     " than 0"
-                  << std::endl;
+        Logger::instance().log(LOG_WARNING, LOG_FORMAT_TOTAL_TIME_NOT_POSITIVE);
     }
     return acceleration_time + cruising_time + deceleration_time;
 }
@@ -522,13 +709,12 @@ void StepperController::send_data(float time_elapsed) {
     }
     memset(buffer, 0, buffer_size);
     int n = snprintf(buffer, buffer_size, "%.3f,%.3f,%.3f,%.3f\n", time_elapsed, _current_position, _current_velocity, _current_acceleration);
-    printf("Sending data: %s", buffer);
     if (send(_socket_fd, buffer, n, 0) < 0) {
         perror("Failed to send data");
         exit(EXIT_FAILURE);
     }
-    std::this_thread::sleep_for(std::chrono::milliseconds(100));
-    printf("Data sent successfully.\n");
+    Logger::instance().log(LOG_DEBUG, LOG_FORMAT_DATA_SENT, time_elapsed, _current_position, _current_velocity,
+                           _current_acceleration);
     free(buffer);
 }
 
@@ -556,4 +742,96 @@ void StepperController::setCommunicationFlag(bool communicationFlag) {
     _communication_flag = communicationFlag;
 }
 
+/// @brief Returns the path of the trajectory archive runs are appended to.
+/// @return The archive path, empty if archiving is disabled.
+const std::string &StepperController::getArchivePath() const {
+    return _archive_path;
+}
+
+/// @brief Sets the trajectory archive every call to step() appends its run to. An empty path disables archiving.
+/// @param archivePath The new archive path.
+void StepperController::setArchivePath(const std::string &archivePath) {
+    _archive_path = archivePath;
+}
+
+/// @brief Returns the value of the _archive_compression_flag attribute.
+/// @return The value of _archive_compression_flag.
+bool StepperController::isArchiveCompressionFlag() const {
+    return _archive_compression_flag;
+}
+
+/// @brief Sets the value of the _archive_compression_flag attribute to the given value.
+/// @param archiveCompressionFlag The new value for the _archive_compression_flag attribute.
+void StepperController::setArchiveCompressionFlag(bool archiveCompressionFlag) {
+    _archive_compression_flag = archiveCompressionFlag;
+}
+
+/// @brief Returns the path of the csv file every move writes its samples to.
+/// @return The trajectory file path, empty if the csv output is disabled.
+const std::string &StepperController::getTrajectoryFilePath() const {
+    return _trajectory_file_path;
+}
+
+/// @brief Sets the csv file every move writes its samples to. Controllers running concurrently need distinct paths,
+/// an empty path disables the csv output.
+/// @param trajectoryFilePath The new trajectory file path.
+void StepperController::setTrajectoryFilePath(const std::string &trajectoryFilePath) {
+    _trajectory_file_path = trajectoryFilePath;
+}
 
+/// @brief Returns the time between two samples of the trajectory.
+/// @return The time step in seconds.
+float StepperController::getTimeStep() const {
+    return _time_step;
+}
+
+/// @brief Sets the time between two samples of the trajectory. Samples are exact for any time step, coarser steps
+/// only mean fewer of them.
+/// @param timeStep The new time step in seconds, has to be greater than 0.
+void StepperController::setTimeStep(float timeStep) {
+    _time_step = timeStep;
+}
+
+/// @brief Returns how samples are spread over the move.
+/// @return The sampling mode.
+SamplingMode StepperController::getSamplingMode() const {
+    return _sampling_mode;
+}
+
+/// @brief Sets how samples are spread over the move. In SAMPLING_ADAPTIVE mode the time step is ignored.
+/// @param samplingMode The new sampling mode.
+void StepperController::setSamplingMode(SamplingMode samplingMode) {
+    _sampling_mode = samplingMode;
+}
+
+/// @brief Returns the maximum distance between the trajectory and straight lines drawn between adaptive samples.
+/// @return The position tolerance in steps.
+float StepperController::getPositionTolerance() const {
+    return _position_tolerance;
+}
+
+/// @brief Sets the maximum distance between the trajectory and straight lines drawn between adaptive samples.
+/// @param positionTolerance The new position tolerance in steps, has to be greater than 0.
+void StepperController::setPositionTolerance(float positionTolerance) {
+    _position_tolerance = positionTolerance;
+}
+
+/// @brief Returns the name of the shared memory object telemetry is published to.
+/// @return The shared memory name, empty if shared memory telemetry is disabled.
+const std::string &StepperController::getSharedMemoryTelemetryName() const {
+    return _shared_memory_telemetry_name;
+}
+
+/// @brief Publishes every sample to a shared memory ring (/dev/shm/<name>) that any number of local readers can
+/// follow, see SharedMemoryTelemetry.h. Publishing makes no system call, unlike the socket. An empty name disables it.
+/// @param sharedMemoryTelemetryName The new shared memory name.
+void StepperController::setSharedMemoryTelemetryName(const std::string &sharedMemoryTelemetryName) {
+    _shared_memory_telemetry_name = sharedMemoryTelemetryName;
+    _telemetry_publisher.reset();
+    if (!_shared_memory_telemetry_name.empty()) {
+        _telemetry_publisher.reset(new SharedMemoryTelemetryPublisher(_shared_memory_telemetry_name));
+        if (!_telemetry_publisher->isOpen()) {
+            _telemetry_publisher.reset();
+        }
+    }
+}
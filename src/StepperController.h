@@ -16,25 +16,84 @@
 #include <chrono>
 #include <thread>
 #include <cstdlib>
+#include <string>
+#include <atomic>
+#include <vector>
+#include <memory>
+
+#include "Logger.h"
+#include "MotorController.h"
+#include "SharedMemoryTelemetry.h"
+#include "TrajectoryArchive.h"
+
+
+// Constant acceleration piece of a motion profile. A trapezoidal move is an acceleration, a cruise and a deceleration
+// segment, a triangular move has a cruise segment of zero duration.
+struct MotionSegment {
+    double start_time;
+    double duration;
+    double start_position;
+    double start_velocity;
+    double acceleration;
+};
+
+// A move has at most an acceleration, a cruise and a deceleration segment, a stop replaces them with a single one
+const size_t MAX_MOTION_SEGMENTS = 3;
+
+
+// How the samples of a move are spread over time.
+// SAMPLING_UNIFORM: one sample every time step.
+// SAMPLING_ADAPTIVE: every phase breakpoint plus the fewest samples keeping straight lines between them within the
+// position tolerance. Each sample carries the acceleration that holds until the next one, so the exact trajectory
+// is S = s + v*t + 0.5 * a*t^2 from the last sample.
+enum SamplingMode {
+    SAMPLING_UNIFORM,
+    SAMPLING_ADAPTIVE
+};
 
 
-class StepperController {
+class StepperController final : public MotorController {
 public:
     //Constructor
     StepperController(float initial_position, float initial_velocity);
 
-    virtual ~StepperController();
+    ~StepperController() override;
 
     StepperController(float initial_position, float initial_velocity, float goal_position, float max_velocity,
                       float max_acceleration);
 
-    float getCurrentPosition() const;
+    float getCurrentPosition() const override;
+
+    float getCurrentVelocity() const override;
+
+    float getCurrentAcceleration() const;
+
+    float getTimeElapsed() const;
 
-    float getCurrentVelocity() const;
+    float getInitialPosition() const;
 
-    void set_goal(float position, float velocity, float acceleration);
+    float getInitialVelocity() const;
 
-    void step();
+    float getGoalPosition() const;
+
+    float getMaxVelocity() const;
+
+    float getMaxAcceleration() const;
+
+    void set_goal(float position, float velocity, float acceleration) override;
+
+    void step() override;
+
+    std::chrono::milliseconds getRealTimeTickPeriod() const;
+
+    bool begin_move() override;
+    bool tick() override;
+    void finish_move() override;
+    void request_stop() override;
+    bool isStopRequested() const;
+    float getProgress() const override;
+    bool isMoveActive() const override;
+    bool isMoveCancelled() const override;
 
     bool pre_motion_sanity_checks(float initial_position, float initial_velocity, float
     goal_position, float max_velocity, float max_acceleration);
@@ -43,25 +102,68 @@ public:
     void setDistanceAndTimeDebugFlag(bool distanceAndTimeDebugFlag);
     bool isGraphRealTimeFlag() const;
     void setGraphRealTimeFlag(bool graphRealTimeFlag);
+    const std::string &getArchivePath() const;
+    void setArchivePath(const std::string &archivePath);
+    bool isArchiveCompressionFlag() const;
+    void setArchiveCompressionFlag(bool archiveCompressionFlag);
+    const std::string &getTrajectoryFilePath() const;
+    void setTrajectoryFilePath(const std::string &trajectoryFilePath);
+    float getTimeStep() const;
+    void setTimeStep(float timeStep);
+    SamplingMode getSamplingMode() const;
+    void setSamplingMode(SamplingMode samplingMode);
+    float getPositionTolerance() const;
+    void setPositionTolerance(float positionTolerance);
+    const std::string &getSharedMemoryTelemetryName() const;
+    void setSharedMemoryTelemetryName(const std::string &sharedMemoryTelemetryName);
 
 
 
 private:
-    float _initial_position;
-    float _initial_velocity;
+    // State of the move between begin_move() and finish_move(). Everything tick() reads comes first and the segments
+    // are stored inline, so ticking axes laid out next to each other (see ControllerBatch) touches a few cache lines
+    // per axis and follows no pointer.
+    MotionSegment _motion_segments[MAX_MOTION_SEGMENTS];
+    size_t _segment_count;
+    size_t _segment_index;
+    size_t _sample_index;
+    double _sample_time;
+    double _total_time;
+    double _end_position;
     float _current_position;
     float _current_velocity;
     float _current_acceleration;
+    float _time_elapsed;
+    float _time_step;
+    SamplingMode _sampling_mode;
+    float _position_tolerance;
+    float _remaining_distance;
+    float _distance_covered;
+    float _total_distance;
     float _goal_position;
-    float _max_velocity;
     float _max_acceleration;
+    std::atomic<bool> _stop_requested;
+    std::atomic<float> _progress;
+    bool _move_active;
+    bool _move_cancelled;
+    bool _trapezoid_curve_debug_flag;
+    bool _graph_real_time_flag;
+    bool _communication_flag;
+    std::unique_ptr<SharedMemoryTelemetryPublisher> _telemetry_publisher;
+    std::string _archive_path;
+
+    float _initial_position;
+    float _initial_velocity;
+    float _max_velocity;
     bool _sanity_check_flag;
 
 
     bool _distance_and_time_debug_flag;
-    bool _trapezoid_curve_debug_flag;
-    bool _graph_real_time_flag;
-    bool _communication_flag;
+    bool _archive_compression_flag;
+    TrajectoryColumns _trajectory_columns;
+    std::string _trajectory_file_path;
+    std::ofstream _trajectory_file;
+    std::string _shared_memory_telemetry_name;
 public:
     bool isCommunicationFlag() const;
 
@@ -86,38 +188,34 @@ private:
     bool isDistanceAndTimeDebugFlag() const;
 
 
-    void accelerate(float &current_velocity, float &max_velocity, float &current_position, float &current_acceleration,
-                    float max_acceleration, float time_step);
+    void append_motion_segment(double duration, double acceleration);
 
-    void cruise(float &current_velocity, float &current_position, float max_velocity, float &current_acceleration,
-                float time_step);
+    void sample_motion(double time);
 
-    void
-    decelerate(float &current_velocity, float &current_position, float &current_acceleration, float max_acceleration,
-               float time_step);
+    double next_sample_time();
+
+    void plan_stop();
 
     void
     update_trajectory(std::ofstream &trajectory_file, float &time_elapsed, float &current_position,
                       float &current_velocity,
                       float &current_acceleration);
 
-    void generate_trajectory(float &total_time, float &time_elapsed, float &acceleration_time, float &cruising_time,
-                             float &time_step, std::ofstream &trajectory_file, float &remaining_distance,
-                             float &distance_covered, float &total_distance);
-
     float calculate_total_distance();
 
-    float calculate_acceleration_time();
+    float calculate_peak_velocity(float total_distance);
+
+    float calculate_acceleration_time(float peak_velocity);
 
     float calculate_acceleration_distance(float acceleration_time);
 
-    float calculate_deceleration_time();
+    float calculate_deceleration_time(float peak_velocity);
 
     float calculate_deceleration_distance(float deceleration_time);
 
     float calculate_cruising_distance(float total_distance, float acceleration_distance, float deceleration_distance);
 
-    float calculate_cruising_time(float cruising_distance);
+    float calculate_cruising_time(float cruising_distance, float peak_velocity);
 
     float calculate_remaining_distance();
 
@@ -0,0 +1,387 @@
+//
+// Created by chu-chu on 10/19/26.
+//
+
+#include "TrajectoryArchive.h"
+
+#include <algorithm>
+#include <iostream>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef STEPPER_ARCHIVE_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace {
+
+    size_t align_up(size_t value) {
+        return (value + TRAJECTORY_ARCHIVE_ALIGNMENT - 1) / TRAJECTORY_ARCHIVE_ALIGNMENT * TRAJECTORY_ARCHIVE_ALIGNMENT;
+    }
+
+    bool write_all(int fd, const unsigned char *buffer, size_t size, off_t offset) {
+        while (size > 0) {
+            ssize_t written = pwrite(fd, buffer, size, offset);
+            if (written < 0) {
+                return false;
+            }
+            buffer += written;
+            size -= static_cast<size_t>(written);
+            offset += written;
+        }
+        return true;
+    }
+
+}
+
+/// @brief Appends one sample to every column
+/// @param time_elapsed the time elapsed since the beginning of the motion
+/// @param current_position the position of the stepper motor at time_elapsed
+/// @param current_velocity the velocity of the stepper motor at time_elapsed
+/// @param current_acceleration the acceleration of the stepper motor at time_elapsed
+void TrajectoryColumns::append(float time_elapsed, float current_position, float current_velocity,
+                               float current_acceleration) {
+    time.push_back(time_elapsed);
+    position.push_back(current_position);
+    velocity.push_back(current_velocity);
+    acceleration.push_back(current_acceleration);
+}
+
+/// @brief Removes all samples, keeping the allocated capacity for the next run
+void TrajectoryColumns::clear() {
+    time.clear();
+    position.clear();
+    velocity.clear();
+    acceleration.clear();
+}
+
+/// @brief Returns the number of samples held in each column
+size_t TrajectoryColumns::size() const {
+    return time.size();
+}
+
+/// @brief Returns the vector backing the given column
+const std::vector<float> &TrajectoryColumns::column(TrajectoryColumn column) const {
+    switch (column) {
+        case TRAJECTORY_COLUMN_POSITION:
+            return position;
+        case TRAJECTORY_COLUMN_VELOCITY:
+            return velocity;
+        case TRAJECTORY_COLUMN_ACCELERATION:
+            return acceleration;
+        default:
+            return time;
+    }
+}
+
+/// @brief Constructor for the archive writer. Nothing is opened until a run is appended.
+/// @param path the archive file, created on the first append
+/// @param compress zlib compress the columns. Ignored with a warning when the build has no zlib support.
+TrajectoryArchiveWriter::TrajectoryArchiveWriter(const std::string &path, bool compress) :
+        _path(path),
+        _compress(compress) {
+    if (_compress and !isCompressionAvailable()) {
+        std::cerr << "WARNING: Archive compression requested but zlib is not available, storing raw columns"
+                  << std::endl;
+        _compress = false;
+    }
+}
+
+/// @brief Returns true when the build was linked against zlib
+bool TrajectoryArchiveWriter::isCompressionAvailable() {
+#ifdef STEPPER_ARCHIVE_HAVE_ZLIB
+    return true;
+#else
+    return false;
+#endif
+}
+
+/// @brief Appends a run to the archive, creating the archive if the file is new.
+/// @param info the motion parameters of the run
+/// @param columns the sampled trajectory of the run
+/// @return true if the whole run was written, false otherwise
+/// @details The run is assembled in memory and written after the newest complete run, then the archive header is
+/// updated to include it, so a reader never indexes a partially written run. Only the archive header is read, the
+/// cost of an append doesn't grow with the number of runs. Appends from several processes are serialized with an
+/// exclusive lock on the file.
+bool TrajectoryArchiveWriter::append_run(const TrajectoryRunInfo &info, const TrajectoryColumns &columns) {
+    int fd = open(_path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        perror("Failed to open trajectory archive");
+        return false;
+    }
+    // Released by close()
+    if (flock(fd, LOCK_EX) < 0) {
+        perror("Failed to lock trajectory archive");
+        close(fd);
+        return false;
+    }
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) < 0) {
+        perror("Failed to stat trajectory archive");
+        close(fd);
+        return false;
+    }
+    size_t file_size = static_cast<size_t>(file_stat.st_size);
+
+    TrajectoryArchiveHeader archive_header;
+    memset(&archive_header, 0, sizeof(archive_header));
+    if (file_size == 0) {
+        memcpy(archive_header.magic, "SMTA", 4);
+        archive_header.version = TRAJECTORY_ARCHIVE_VERSION;
+        archive_header.header_size = sizeof(TrajectoryArchiveHeader);
+        archive_header.end_offset = sizeof(TrajectoryArchiveHeader);
+    } else if (pread(fd, &archive_header, sizeof(archive_header), 0) != sizeof(archive_header) or
+               memcmp(archive_header.magic, "SMTA", 4) != 0 or
+               archive_header.version != TRAJECTORY_ARCHIVE_VERSION) {
+        std::cerr << "Error, " << _path << " is not a trajectory archive, refusing to append" << std::endl;
+        close(fd);
+        return false;
+    }
+    if (file_size > 0 and (archive_header.end_offset < sizeof(TrajectoryArchiveHeader) or
+                           archive_header.end_offset % TRAJECTORY_ARCHIVE_ALIGNMENT != 0 or
+                           archive_header.end_offset > file_size)) {
+        std::cerr << "Error, trajectory archive " << _path << " is truncated, refusing to append" << std::endl;
+        close(fd);
+        return false;
+    }
+
+    TrajectoryRunHeader run_header;
+    memset(&run_header, 0, sizeof(run_header));
+    memcpy(run_header.magic, "RUN0", 4);
+    run_header.run_id = static_cast<uint32_t>(archive_header.run_count);
+    run_header.sample_count = columns.size();
+    run_header.column_count = TRAJECTORY_COLUMN_COUNT;
+    run_header.flags = _compress ? TRAJECTORY_RUN_COMPRESSED : 0u;
+    run_header.unix_time_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    run_header.initial_position = info.initial_position;
+    run_header.initial_velocity = info.initial_velocity;
+    run_header.goal_position = info.goal_position;
+    run_header.max_velocity = info.max_velocity;
+    run_header.max_acceleration = info.max_acceleration;
+    run_header.time_step = info.time_step;
+    std::vector<unsigned char> chunk(sizeof(run_header));
+
+    for (int column = 0; column < TRAJECTORY_COLUMN_COUNT; ++column) {
+        const std::vector<float> &values = columns.column(static_cast<TrajectoryColumn>(column));
+        const unsigned char *raw = reinterpret_cast<const unsigned char *>(values.data());
+        size_t raw_bytes = values.size() * sizeof(float);
+        size_t column_start = chunk.size();
+
+        if (_compress) {
+#ifdef STEPPER_ARCHIVE_HAVE_ZLIB
+            uLongf compressed_bytes = compressBound(raw_bytes);
+            chunk.resize(column_start + compressed_bytes);
+            if (compress2(chunk.data() + column_start, &compressed_bytes, raw, raw_bytes, Z_BEST_SPEED) != Z_OK) {
+                std::cerr << "Error, failed to compress trajectory column" << std::endl;
+                close(fd);
+                return false;
+            }
+            raw_bytes = compressed_bytes;
+#endif
+        } else {
+            chunk.resize(column_start + raw_bytes);
+            if (raw_bytes > 0) {
+                memcpy(chunk.data() + column_start, raw, raw_bytes);
+            }
+        }
+        chunk.resize(align_up(column_start + raw_bytes), 0);
+        run_header.column_offset[column] = column_start;
+        run_header.column_bytes[column] = raw_bytes;
+    }
+
+    run_header.chunk_size = chunk.size();
+    memcpy(chunk.data(), &run_header, sizeof(run_header));
+
+    // Anything past the newest complete run is what's left of an append that didn't finish, it gets overwritten
+    off_t run_offset = static_cast<off_t>(archive_header.end_offset);
+    bool written = write_all(fd, chunk.data(), chunk.size(), run_offset);
+    if (written and static_cast<size_t>(run_offset) + chunk.size() < file_size) {
+        written = ftruncate(fd, run_offset + static_cast<off_t>(chunk.size())) == 0;
+    }
+    if (written) {
+        archive_header.run_count += 1;
+        archive_header.last_run_offset = archive_header.end_offset;
+        archive_header.end_offset += chunk.size();
+        written = write_all(fd, reinterpret_cast<const unsigned char *>(&archive_header), sizeof(archive_header), 0);
+    }
+    if (!written) {
+        perror("Failed to write trajectory archive");
+    }
+    close(fd);
+    return written;
+}
+
+/// @brief Constructor for the archive reader. Maps the whole archive read-only, the runs are indexed on first access.
+/// @param path the archive file to open. isOpen() returns false if it is missing or not an archive.
+TrajectoryArchiveReader::TrajectoryArchiveReader(const std::string &path) :
+        _fd(-1),
+        _data(nullptr),
+        _size(0),
+        _end(0),
+        _indexed(false) {
+    _fd = open(path.c_str(), O_RDONLY);
+    if (_fd < 0) {
+        return;
+    }
+    struct stat file_stat;
+    if (fstat(_fd, &file_stat) < 0 or file_stat.st_size < static_cast<off_t>(sizeof(TrajectoryArchiveHeader))) {
+        return;
+    }
+    _size = static_cast<size_t>(file_stat.st_size);
+    void *mapping = mmap(nullptr, _size, PROT_READ, MAP_SHARED, _fd, 0);
+    if (mapping == MAP_FAILED) {
+        _size = 0;
+        return;
+    }
+    _data = static_cast<const unsigned char *>(mapping);
+
+    const TrajectoryArchiveHeader *header = reinterpret_cast<const TrajectoryArchiveHeader *>(_data);
+    if (memcmp(header->magic, "SMTA", 4) != 0 or header->version != TRAJECTORY_ARCHIVE_VERSION) {
+        std::cerr << "Error, " << path << " is not a trajectory archive" << std::endl;
+        munmap(const_cast<unsigned char *>(_data), _size);
+        _data = nullptr;
+        _size = 0;
+        return;
+    }
+    // Runs past end_offset are still being written
+    _end = std::min<size_t>(header->end_offset, _size);
+}
+
+TrajectoryArchiveReader::~TrajectoryArchiveReader() {
+    if (_data != nullptr) {
+        munmap(const_cast<unsigned char *>(_data), _size);
+    }
+    if (_fd >= 0) {
+        close(_fd);
+    }
+}
+
+/// @brief Checks that a run header describes columns lying entirely within its own chunk, so nothing read through
+/// it can go past the end of the mapping
+/// @param run the run header
+/// @param available bytes from the start of the run header to the end of the archive
+/// @return true if the run can be indexed
+bool TrajectoryArchiveReader::isRunValid(const TrajectoryRunHeader &run, size_t available) {
+    if (memcmp(run.magic, "RUN0", 4) != 0 or run.chunk_size < sizeof(TrajectoryRunHeader) or
+        run.chunk_size > available or run.column_count != TRAJECTORY_COLUMN_COUNT or
+        run.sample_count > run.chunk_size / sizeof(float)) {
+        return false;
+    }
+    for (int column = 0; column < TRAJECTORY_COLUMN_COUNT; ++column) {
+        uint64_t offset = run.column_offset[column];
+        uint64_t bytes = run.column_bytes[column];
+        if (offset < sizeof(TrajectoryRunHeader) or offset % sizeof(float) != 0 or offset > run.chunk_size or
+            bytes > run.chunk_size - offset) {
+            return false;
+        }
+        if (!(run.flags & TRAJECTORY_RUN_COMPRESSED) and bytes != run.sample_count * sizeof(float)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/// @brief Walks the run headers from the start of the archive. Indexing stops at the first run that is only
+/// partially written or whose header is corrupted, so every indexed column can be read safely.
+void TrajectoryArchiveReader::build_run_index() const {
+    _indexed = true;
+    if (_data == nullptr) {
+        return;
+    }
+    const TrajectoryArchiveHeader &header = getHeader();
+    _runs.reserve(header.run_count);
+    size_t offset = header.header_size;
+    while (offset + sizeof(TrajectoryRunHeader) <= _end) {
+        const TrajectoryRunHeader *run = reinterpret_cast<const TrajectoryRunHeader *>(_data + offset);
+        if (!isRunValid(*run, _end - offset)) {
+            break;
+        }
+        _runs.push_back(run);
+        offset += run->chunk_size;
+    }
+}
+
+/// @brief Returns true if the archive was mapped successfully
+bool TrajectoryArchiveReader::isOpen() const {
+    return _data != nullptr;
+}
+
+/// @brief Returns the number of complete runs in the archive
+size_t TrajectoryArchiveReader::getRunCount() const {
+    if (!_indexed) {
+        build_run_index();
+    }
+    return _runs.size();
+}
+
+/// @brief Returns the archive header, which holds the run count and the offset of the newest run. Only valid when
+/// isOpen() returns true.
+const TrajectoryArchiveHeader &TrajectoryArchiveReader::getHeader() const {
+    return *reinterpret_cast<const TrajectoryArchiveHeader *>(_data);
+}
+
+/// @brief Returns the header of the given run
+/// @param run index of the run, 0 being the oldest
+const TrajectoryRunHeader &TrajectoryArchiveReader::getRunHeader(size_t run) const {
+    if (!_indexed) {
+        build_run_index();
+    }
+    return *_runs.at(run);
+}
+
+/// @brief Returns where the given run starts, relative to the start of the archive
+/// @param run index of the run, 0 being the oldest
+uint64_t TrajectoryArchiveReader::getRunOffset(size_t run) const {
+    return reinterpret_cast<const unsigned char *>(&getRunHeader(run)) - _data;
+}
+
+/// @brief Returns a pointer straight into the mapped archive for an uncompressed column, without copying
+/// @param run index of the run, 0 being the oldest
+/// @param column the column to access
+/// @return getRunHeader(run).sample_count floats, or nullptr if the run is compressed
+const float *TrajectoryArchiveReader::column_data(size_t run, TrajectoryColumn column) const {
+    const TrajectoryRunHeader &header = getRunHeader(run);
+    if (header.flags & TRAJECTORY_RUN_COMPRESSED) {
+        return nullptr;
+    }
+    return reinterpret_cast<const float *>(reinterpret_cast<const unsigned char *>(&header) +
+                                           header.column_offset[column]);
+}
+
+/// @brief Copies a column into out, decompressing it if needed
+/// @param run index of the run, 0 being the oldest
+/// @param column the column to read
+/// @param out resized to the number of samples in the run
+/// @return true on success, false if the column could not be decompressed
+bool TrajectoryArchiveReader::read_column(size_t run, TrajectoryColumn column, std::vector<float> &out) const {
+    const TrajectoryRunHeader &header = getRunHeader(run);
+    out.resize(header.sample_count);
+    const unsigned char *source = reinterpret_cast<const unsigned char *>(&header) + header.column_offset[column];
+
+    if (!(header.flags & TRAJECTORY_RUN_COMPRESSED)) {
+        if (!out.empty()) {
+            memcpy(out.data(), source, out.size() * sizeof(float));
+        }
+        return true;
+    }
+#ifdef STEPPER_ARCHIVE_HAVE_ZLIB
+    uLongf raw_bytes = out.size() * sizeof(float);
+    if (uncompress(reinterpret_cast<unsigned char *>(out.data()), &raw_bytes, source,
+                   header.column_bytes[column]) != Z_OK or raw_bytes != out.size() * sizeof(float)) {
+        std::cerr << "Error, failed to decompress trajectory column" << std::endl;
+        return false;
+    }
+    return true;
+#else
+    std::cerr << "Error, run " << run << " is compressed but zlib is not available" << std::endl;
+    return false;
+#endif
+}
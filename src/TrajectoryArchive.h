@@ -0,0 +1,144 @@
+//
+// Created by chu-chu on 10/19/26.
+//
+
+#ifndef URBAN_MACHINE_GENERIC_STEPPER_MOTOR_CONTROLLER_TRAJECTORYARCHIVE_H
+#define URBAN_MACHINE_GENERIC_STEPPER_MOTOR_CONTROLLER_TRAJECTORYARCHIVE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// On-disk layout (little endian, every block 64-byte aligned so columns can be memory mapped directly):
+//   TrajectoryArchiveHeader
+//   TrajectoryRunHeader, time[], position[], velocity[], acceleration[]   <- one chunk per run, appended
+//   TrajectoryRunHeader, time[], position[], velocity[], acceleration[]
+//   ...
+// Columns are contiguous float32 arrays. A column is zlib compressed when TRAJECTORY_RUN_COMPRESSED is set in the
+// run flags, in which case column_bytes holds the compressed size.
+// The archive header keeps the run count and where the runs end, updated after every append, so appending never has
+// to walk the runs.
+
+enum TrajectoryColumn {
+    TRAJECTORY_COLUMN_TIME = 0,
+    TRAJECTORY_COLUMN_POSITION = 1,
+    TRAJECTORY_COLUMN_VELOCITY = 2,
+    TRAJECTORY_COLUMN_ACCELERATION = 3,
+    TRAJECTORY_COLUMN_COUNT = 4
+};
+
+const uint32_t TRAJECTORY_RUN_COMPRESSED = 1u;
+const uint32_t TRAJECTORY_ARCHIVE_VERSION = 1u;
+const size_t TRAJECTORY_ARCHIVE_ALIGNMENT = 64;
+
+struct TrajectoryArchiveHeader {
+    char magic[4];              // "SMTA"
+    uint32_t version;
+    uint32_t header_size;
+    uint32_t reserved0;
+    uint64_t run_count;         // runs appended so far
+    uint64_t end_offset;        // end of the newest complete run, where the next one is written
+    uint64_t last_run_offset;   // start of the newest run
+    uint32_t reserved[6];
+};
+
+struct TrajectoryRunHeader {
+    char magic[4];              // "RUN0"
+    uint32_t run_id;
+    uint64_t sample_count;
+    uint32_t column_count;
+    uint32_t flags;
+    uint64_t chunk_size;        // header + padded columns, offset of the next run relative to this one
+    int64_t unix_time_ns;
+    float initial_position;
+    float initial_velocity;
+    float goal_position;
+    float max_velocity;
+    float max_acceleration;
+    float time_step;            // 0 for adaptively sampled runs
+    uint64_t column_offset[TRAJECTORY_COLUMN_COUNT];  // relative to the start of this run header
+    uint64_t column_bytes[TRAJECTORY_COLUMN_COUNT];
+};
+
+static_assert(sizeof(TrajectoryArchiveHeader) == 64, "archive header must stay 64 bytes");
+static_assert(sizeof(TrajectoryRunHeader) == 128, "run header must stay 128 bytes");
+
+// Samples of a single run, one contiguous vector per column
+struct TrajectoryColumns {
+    std::vector<float> time;
+    std::vector<float> position;
+    std::vector<float> velocity;
+    std::vector<float> acceleration;
+
+    void append(float time_elapsed, float current_position, float current_velocity, float current_acceleration);
+    void clear();
+    size_t size() const;
+    const std::vector<float> &column(TrajectoryColumn column) const;
+};
+
+// Motion parameters stored alongside every run
+struct TrajectoryRunInfo {
+    float initial_position;
+    float initial_velocity;
+    float goal_position;
+    float max_velocity;
+    float max_acceleration;
+    float time_step;            // 0 for adaptively sampled runs
+};
+
+
+class TrajectoryArchiveWriter {
+public:
+    TrajectoryArchiveWriter(const std::string &path, bool compress);
+
+    bool append_run(const TrajectoryRunInfo &info, const TrajectoryColumns &columns);
+
+    static bool isCompressionAvailable();
+
+private:
+    std::string _path;
+    bool _compress;
+};
+
+
+class TrajectoryArchiveReader {
+public:
+    explicit TrajectoryArchiveReader(const std::string &path);
+
+    virtual ~TrajectoryArchiveReader();
+
+    TrajectoryArchiveReader(const TrajectoryArchiveReader &) = delete;
+
+    TrajectoryArchiveReader &operator=(const TrajectoryArchiveReader &) = delete;
+
+    bool isOpen() const;
+
+    size_t getRunCount() const;
+
+    const TrajectoryArchiveHeader &getHeader() const;
+
+    uint64_t getRunOffset(size_t run) const;
+
+    const TrajectoryRunHeader &getRunHeader(size_t run) const;
+
+    const float *column_data(size_t run, TrajectoryColumn column) const;
+
+    bool read_column(size_t run, TrajectoryColumn column, std::vector<float> &out) const;
+
+    static bool isRunValid(const TrajectoryRunHeader &run, size_t available);
+
+private:
+    int _fd;
+    const unsigned char *_data;
+    size_t _size;
+    size_t _end;
+    // Built on first use so opening an archive costs the same whatever the number of runs
+    mutable bool _indexed;
+    mutable std::vector<const TrajectoryRunHeader *> _runs;
+
+    void build_run_index() const;
+};
+
+
+#endif //URBAN_MACHINE_GENERIC_STEPPER_MOTOR_CONTROLLER_TRAJECTORYARCHIVE_H
@@ -2,6 +2,13 @@
 #include <iostream>
 
 #include "../src/StepperController.h"
+#include "../src/TrajectoryArchive.h"
+#include "../src/MoveExecutor.h"
+#include "../src/ControllerBatch.h"
+#include "../src/SharedMemoryTelemetry.h"
+#include "../src/Logger.h"
+#include "../src/Kinematics.h"
+#include "../src/SessionJournal.h"
 
 
 void test_getCurrentPosition() {
@@ -25,6 +32,9 @@ void test_pre_motion_sanity_checks() {
     assert(sc.pre_motion_sanity_checks(0.0, -20.0, 50.0, 10.0, 2.0) == true);
     assert(sc.pre_motion_sanity_checks(0.0, -20.0, -50.0, -10.0, 2.0) == false);
     assert(sc.pre_motion_sanity_checks(0.0, 0.0, 100.0, 20.0, -2.0) == false);
+    assert(sc.pre_motion_sanity_checks(10.0, 0.0, 5.0, 20.0, 2.0) == false);
+    assert(sc.pre_motion_sanity_checks(0.0, 20.0, 50.0, 30.0, 2.0) == false);
+    assert(sc.pre_motion_sanity_checks(0.0, 20.0, 100.0, 30.0, 2.0) == true);
 
 }
 
@@ -35,6 +45,8 @@ bool is_equal(float a, float b, float epsilon = 0.0001) {
 
 void test_step() {
     StepperController sc(0, 0, 100, 10, 1);
+    // Streaming to the plot socket, step() spaces the ticks so the graph is drawn in real time
+    assert(sc.getRealTimeTickPeriod() == std::chrono::milliseconds(100));
     sc.step();
     // Assert that the generated trajectory is not empty
     std::ifstream trajectory_file("../trajectories.csv");
@@ -42,10 +54,542 @@ void test_step() {
     trajectory_file.close();
 }
 
+void test_trajectory_archive() {
+    const std::string archive_path = "test_trajectories.smta";
+    std::remove(archive_path.c_str());
+
+    TrajectoryColumns columns;
+    for (int i = 0; i < 100; ++i) {
+        columns.append(i * 0.1f, i * 2.0f, 20.0f, i < 50 ? 2.0f : 0.0f);
+    }
+    TrajectoryRunInfo info = {0, 0, 200, 20, 2, 0.1f};
+    assert(TrajectoryArchiveWriter(archive_path, false).append_run(info, columns));
+    columns.clear();
+    columns.append(0, 5, 1, 1);
+    assert(TrajectoryArchiveWriter(archive_path, true).append_run(info, columns));
+
+    TrajectoryArchiveReader reader(archive_path);
+    assert(reader.isOpen());
+    assert(reader.getRunCount() == 2);
+    assert(reader.getRunHeader(0).sample_count == 100);
+    assert(reader.getRunHeader(1).run_id == 1);
+    assert(is_equal(reader.getRunHeader(0).goal_position, 200));
+
+    // Uncompressed columns are read in place from the mapping
+    const float *position = reader.column_data(0, TRAJECTORY_COLUMN_POSITION);
+    assert(position != nullptr);
+    assert(reinterpret_cast<uintptr_t>(position) % TRAJECTORY_ARCHIVE_ALIGNMENT == 0);
+    assert(is_equal(position[99], 198));
+
+    std::vector<float> velocity;
+    assert(reader.read_column(1, TRAJECTORY_COLUMN_VELOCITY, velocity));
+    assert(velocity.size() == 1 and is_equal(velocity[0], 1));
+
+    // The archive header keeps track of the runs, appending doesn't walk them
+    const TrajectoryArchiveHeader &header = reader.getHeader();
+    size_t second_run = sizeof(TrajectoryArchiveHeader) + reader.getRunHeader(0).chunk_size;
+    assert(header.run_count == 2 and header.last_run_offset == second_run and reader.getRunOffset(1) == second_run);
+    assert(header.end_offset == second_run + reader.getRunHeader(1).chunk_size);
+
+    // A run header pointing outside its chunk ends the index instead of being read
+    uint64_t bad_offset = 1ull << 40;
+    FILE *file = fopen(archive_path.c_str(), "r+b");
+    fseek(file, static_cast<long>(second_run + offsetof(TrajectoryRunHeader, column_offset) + sizeof(uint64_t)),
+          SEEK_SET);
+    fwrite(&bad_offset, sizeof(bad_offset), 1, file);
+    fclose(file);
+    TrajectoryArchiveReader corrupted(archive_path);
+    assert(corrupted.getRunCount() == 1);
+    std::remove(archive_path.c_str());
+}
+
+void test_move_executor() {
+    StepperController short_move(0, 0);
+    short_move.set_goal(100, 10, 1);
+    short_move.setTrajectoryFilePath("");
+    StepperController long_move(0, 0);
+    long_move.set_goal(100000, 10, 1);
+    long_move.setTrajectoryFilePath("");
+    StepperController rejected_move(0, 0);
+    rejected_move.set_goal(0, 10, 1);
+    rejected_move.setTrajectoryFilePath("");
+
+    // Only step() waits between ticks, and only for controllers streaming to the plot socket
+    assert(short_move.getRealTimeTickPeriod().count() == 0);
+
+    // One worker ticks every move at 1ms per time step
+    MoveExecutor executor(1, std::chrono::microseconds(1000));
+    std::vector<MoveHandle> handles;
+    handles.push_back(executor.submit(short_move));
+    handles.push_back(executor.submit(long_move));
+    handles.push_back(executor.submit(rejected_move));
+    assert(handles[2].isDone() and handles[2].wait() == MOVE_REJECTED);
+
+    assert(handles[0].wait() == MOVE_COMPLETED);
+    assert(is_equal(handles[0].getProgress(), 1));
+    assert(!handles[1].isDone());
+    assert(handles[1].getProgress() > 0);
+
+    handles[1].cancel();
+    MoveExecutor::wait_all(handles);
+    assert(handles[1].wait() == MOVE_CANCELLED);
+    assert(long_move.getCurrentVelocity() == 0);
+    assert(long_move.getCurrentPosition() < 100000);
+    assert(executor.getActiveMoveCount() == 0);
+}
+
+// Minimal second driver type, moves at a constant velocity until it reaches its goal
+class ConstantVelocityController final : public MotorController {
+public:
+    void set_goal(float position, float velocity, float /*acceleration*/) override {
+        goal = position;
+        speed = velocity;
+    }
+    void step() override {
+        if (begin_move()) {
+            while (tick()) {
+            }
+            finish_move();
+        }
+    }
+    bool begin_move() override {
+        active = goal > position;
+        return active;
+    }
+    bool tick() override {
+        if (!active or stop) {
+            active = false;
+            return false;
+        }
+        position = std::fmin(goal, position + speed * 0.1f);
+        active = position < goal;
+        return active;
+    }
+    void finish_move() override { ++finished; }
+    void request_stop() override { stop = true; }
+    float getCurrentPosition() const override { return position; }
+    float getCurrentVelocity() const override { return active ? speed : 0; }
+    float getProgress() const override { return position / goal; }
+    bool isMoveActive() const override { return active; }
+    bool isMoveCancelled() const override { return stop; }
+
+    float position = 0;
+    float goal = 0;
+    float speed = 0;
+    bool active = false;
+    bool stop = false;
+    int finished = 0;
+};
+
+void test_controller_batch() {
+    ControllerBatch<StepperController, ConstantVelocityController> batch;
+    StepperController &x_axis = batch.emplace<StepperController>(0, 0);
+    x_axis.set_goal(100, 10, 1);
+    x_axis.setTrajectoryFilePath("");
+    StepperController &y_axis = batch.emplace<StepperController>(0, 0);
+    y_axis.set_goal(50, 10, 2);
+    y_axis.setTrajectoryFilePath("");
+    ConstantVelocityController &conveyor = batch.emplace<ConstantVelocityController>();
+    conveyor.set_goal(30, 5, 0);
+    assert(batch.size() == 3);
+
+    batch.step_all();
+    assert(!x_axis.isMoveActive() and !y_axis.isMoveActive());
+    assert(x_axis.getProgress() == 1 and y_axis.getProgress() == 1);
+    assert(is_equal(conveyor.getCurrentPosition(), 30) and conveyor.finished == 1);
+
+    // Axes added past the first chunk land in a new one, the ones already added stay where they are
+    ControllerBatch<StepperController> steppers;
+    StepperController &first = steppers.emplace<StepperController>(0, 0);
+    for (int i = 0; i < 100; ++i) {
+        StepperController &axis = steppers.emplace<StepperController>(0, 0);
+        axis.set_goal(static_cast<float>(i + 1), 10, 1);
+        axis.setTrajectoryFilePath("");
+    }
+    first.set_goal(100, 10, 1);
+    first.setTrajectoryFilePath("");
+    assert(steppers.size() == 101 and steppers.begin_all() == 101);
+    steppers.request_stop_all();
+    while (steppers.tick_all() > 0) {
+    }
+    assert(first.isMoveCancelled() and first.getCurrentVelocity() == 0);
+}
+
+void test_exact_goal_landing() {
+    // initial position, initial velocity, goal position, max velocity, max acceleration
+    const float moves[][5] = {{0, 0, 100, 10, 1},      // trapezoidal
+                              {0, 0, 50, 75, 20},      // triangular, max velocity never reached
+                              {-50, -50, 350, 75, 20}, // starts moving away from the goal
+                              {0, 10, 100, 20, 3}};    // starts moving towards the goal
+    const float time_steps[] = {0.01f, 0.1f, 0.37f, 1.0f, 2.5f};
+    for (const auto &move : moves) {
+        for (float time_step : time_steps) {
+            StepperController sc(move[0], move[1]);
+            sc.set_goal(move[2], move[3], move[4]);
+            sc.setTrajectoryFilePath("");
+            sc.setTimeStep(time_step);
+            assert(sc.begin_move());
+            float previous_position = sc.getCurrentPosition();
+            while (sc.tick()) {
+                assert(sc.getCurrentPosition() <= move[2]);
+                assert(sc.getCurrentVelocity() <= move[3] + 0.0001);
+                assert(sc.getCurrentVelocity() >= 0 or sc.getCurrentPosition() <= previous_position);
+                previous_position = sc.getCurrentPosition();
+            }
+            sc.finish_move();
+            assert(sc.getCurrentPosition() == move[2]);
+            assert(sc.getCurrentVelocity() == 0);
+        }
+    }
+
+    // Trapezoidal move from rest: 10s accelerating and decelerating with 50 steps each, no cruise
+    StepperController sc(0, 0);
+    sc.set_goal(100, 10, 1);
+    sc.setTrajectoryFilePath("");
+    sc.setTimeStep(5);
+    assert(sc.begin_move());
+    assert(sc.tick() and is_equal(sc.getCurrentPosition(), 12.5) and is_equal(sc.getCurrentVelocity(), 5));
+    assert(sc.tick() and is_equal(sc.getCurrentPosition(), 50) and is_equal(sc.getCurrentVelocity(), 10));
+    assert(sc.tick() and is_equal(sc.getCurrentPosition(), 87.5) and is_equal(sc.getCurrentVelocity(), 5));
+    assert(sc.tick() and sc.getCurrentPosition() == 100 and sc.getCurrentVelocity() == 0);
+    assert(!sc.tick());
+}
+
+struct TrajectorySample {
+    float time;
+    float position;
+    float velocity;
+    float acceleration;
+};
+
+// Runs the move tick by tick and returns the same samples the trajectory file gets
+std::vector<TrajectorySample> collect_samples(StepperController &sc) {
+    std::vector<TrajectorySample> samples;
+    assert(sc.begin_move());
+    do {
+        samples.push_back({sc.getTimeElapsed(), sc.getCurrentPosition(), sc.getCurrentVelocity(),
+                           sc.getCurrentAcceleration()});
+    } while (sc.tick());
+    sc.finish_move();
+    return samples;
+}
+
+void test_adaptive_sampling() {
+    const float tolerance = 0.01;
+    StepperController adaptive(-50, -50);
+    adaptive.set_goal(5000, 75, 20);
+    adaptive.setTrajectoryFilePath("");
+    adaptive.setSamplingMode(SAMPLING_ADAPTIVE);
+    adaptive.setPositionTolerance(tolerance);
+    std::vector<TrajectorySample> breakpoints = collect_samples(adaptive);
+    assert(adaptive.getCurrentPosition() == 5000 and adaptive.getCurrentVelocity() == 0);
+
+    StepperController uniform(-50, -50);
+    uniform.set_goal(5000, 75, 20);
+    uniform.setTrajectoryFilePath("");
+    uniform.setTimeStep(0.01);
+    std::vector<TrajectorySample> samples = collect_samples(uniform);
+    assert(breakpoints.size() * 10 < samples.size());
+    assert(breakpoints.back().time == samples.back().time);
+
+    // Every uniform sample is rebuilt exactly from the adaptive sample preceding it, and a straight line between
+    // adaptive samples stays within the tolerance
+    size_t k = 0;
+    for (const TrajectorySample &sample : samples) {
+        while (k + 2 < breakpoints.size() and breakpoints[k + 1].time <= sample.time) {
+            ++k;
+        }
+        const TrajectorySample &from = breakpoints[k];
+        const TrajectorySample &to = breakpoints[k + 1];
+        float dt = sample.time - from.time;
+        float position = from.position + from.velocity * dt + 0.5f * from.acceleration * dt * dt;
+        float velocity = from.velocity + from.acceleration * dt;
+        assert(is_equal(position, sample.position, 0.002));
+        assert(is_equal(velocity, sample.velocity, 0.002));
+        float line = from.position + (to.position - from.position) * dt / (to.time - from.time);
+        assert(std::fabs(line - sample.position) <= tolerance + 0.002);
+    }
+}
+
+void test_shared_memory_telemetry() {
+    const std::string name = "stepper_telemetry_test";
+    {
+        SharedMemoryTelemetryPublisher publisher(name, 8);
+        assert(publisher.isOpen());
+        SharedMemoryTelemetryReader reader(name);
+        assert(reader.isOpen());
+        TelemetrySample sample;
+        assert(!reader.read_latest(sample));
+
+        uint64_t cursor = 0;
+        std::vector<TelemetrySample> samples;
+        publisher.publish(0.0f, 1.0f, 2.0f, 3.0f);
+        publisher.publish(0.1f, 1.5f, 2.5f, 3.0f);
+        assert(reader.read_since(cursor, samples) == 2 and cursor == 2);
+        assert(samples[1].position == 1.5f and samples[1].velocity == 2.5f);
+
+        // The ring keeps the 8 newest samples, a reader that fell behind resumes at the oldest one left
+        for (int i = 2; i < 20; ++i) {
+            publisher.publish(i * 0.1f, i, 0, 0);
+        }
+        samples.clear();
+        assert(reader.read_since(cursor, samples) == 8 and cursor == 20);
+        assert(samples.front().position == 12 and samples.back().position == 19);
+        assert(reader.read_latest(sample) and sample.position == 19);
+
+        // A new publisher replaces the ring under the same name, the reader opens the new one and starts over
+        SharedMemoryTelemetryPublisher larger(name, 256);
+        for (int i = 0; i < 200; ++i) {
+            larger.publish(i * 0.1f, 1000 + i, 0, 0);
+        }
+        samples.clear();
+        assert(reader.read_since(cursor, samples) == 200 and cursor == 200);
+        assert(samples.front().position == 1000 and samples.back().position == 1199);
+        assert(reader.read_latest(sample) and sample.position == 1199);
+
+        // A smaller ring never shrinks the one the previous publisher still writes to, and a cursor below the new
+        // write count does not mix the two runs
+        SharedMemoryTelemetryPublisher smaller(name, 8);
+        for (int i = 0; i < 250; ++i) {
+            larger.publish(i * 0.1f, 0, 0, 0);
+        }
+        for (int i = 0; i < 300; ++i) {
+            smaller.publish(i * 0.1f, 2000 + i, 0, 0);
+        }
+        samples.clear();
+        assert(reader.read_since(cursor, samples) == 8 and cursor == 300);
+        assert(samples.front().position == 2292 and samples.back().position == 2299);
+    }
+
+    // The controller publishes every sample of the move, the last one being the goal
+    StepperController sc(0, 0);
+    sc.set_goal(100, 10, 1);
+    sc.setTrajectoryFilePath("");
+    sc.setSharedMemoryTelemetryName(name);
+    SharedMemoryTelemetryReader reader(name);
+    sc.step();
+    TelemetrySample sample;
+    assert(reader.read_latest(sample) and sample.position == 100 and sample.velocity == 0);
+    assert(reader.getWriteCount() == 201);
+    assert(SharedMemoryTelemetryPublisher::remove(name));
+}
+
+void test_logger() {
+    // Records are formatted by the background thread, the format ids and arguments are all the caller stores
+    LogRecord record = LogRecord();
+    record.timestamp_ns = 1500000000123456789;
+    record.format = LOG_FORMAT_MAX_VELOCITY_NOT_REACHED;
+    record.level = LOG_WARNING;
+    record.argument_count = 1;
+    record.arguments[0] = 7.5;
+    record.suppressed = 3;
+    char line[512];
+    size_t length = Logger::format_record(record, line, sizeof(line));
+    std::string text(line, length);
+    assert(text.find(".123456] WARNING ") != std::string::npos);
+    assert(text.find("peaking at 7.5 (3 similar suppressed)\n") != std::string::npos);
+    // Long lines are cut to the buffer
+    assert(Logger::format_record(record, line, 16) == 15 and line[15] == '\0');
+    // A summary of repeats has no arguments to show
+    record.argument_count = LOG_SUPPRESSION_SUMMARY;
+    text.assign(line, Logger::format_record(record, line, sizeof(line)));
+    assert(text.find("WARNING 3 more like: ") != std::string::npos);
+    assert(text.find("peaking at ...\n") != std::string::npos and text.find("{}") == std::string::npos);
+
+    Logger &logger = Logger::instance();
+    LogLevel level = logger.getLevel();
+    logger.setLevel(LOG_ERROR);
+    assert(logger.getLevel() == LOG_ERROR);
+    logger.setRateLimitWindow(std::chrono::milliseconds(250));
+    assert(logger.getRateLimitWindow() == std::chrono::milliseconds(250));
+
+    // Several threads logging at once lose nothing as long as the background thread keeps up. Their output goes to a
+    // file so the summary of the rate limited repeats can be checked.
+    // Repeats left over from earlier tests are reported once their 1 s window is over, before the capture starts.
+    uint64_t dropped = logger.getDroppedRecordCount();
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+    logger.flush();
+    FILE *captured = tmpfile();
+    assert(captured != nullptr);
+    int saved_stderr = dup(STDERR_FILENO);
+    dup2(fileno(captured), STDERR_FILENO);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&logger] {
+            for (int i = 0; i < 1000; ++i) {
+                logger.log(LOG_DEBUG, LOG_FORMAT_DATA_SENT, i, 0, 0, 0);
+                logger.log(LOG_ERROR, LOG_FORMAT_DIVISION_BY_ZERO);
+            }
+        });
+    }
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+    logger.flush();
+    assert(logger.getDroppedRecordCount() == dropped);
+
+    // Repeats still suppressed when the window runs out are summed up at the level they were logged at
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    logger.flush();
+    dup2(saved_stderr, STDERR_FILENO);
+    close(saved_stderr);
+    std::string output(1 << 20, '\0');
+    ssize_t read_size = pread(fileno(captured), &output[0], output.size(), 0);
+    output.resize(read_size > 0 ? read_size : 0);
+    fclose(captured);
+    size_t summary = output.find(" more like: Potential Division by Zero");
+    assert(summary != std::string::npos);
+    size_t line_start = output.rfind('\n', summary) + 1;
+    assert(output.substr(line_start, summary - line_start).find("] ERROR ") != std::string::npos);
+
+    logger.setLevel(level);
+    logger.setRateLimitWindow(std::chrono::milliseconds(1000));
+}
+
+void test_kinematics() {
+    float motors[3];
+    CoreXYKinematics corexy;
+    assert(corexy.inverse({30, 10, 5}, motors) and motors[0] == 40 and motors[1] == 20 and motors[2] == 5);
+
+    // At the center every carriage sits sqrt(L^2 - R^2) above the effector
+    DeltaKinematics delta(250, 100);
+    assert(delta.inverse({0, 0, 10}, motors));
+    for (float height : motors) {
+        assert(is_equal(height, 10 + std::sqrt(250.0f * 250 - 100 * 100), 1e-3));
+    }
+    assert(!delta.inverse({400, 0, 0}, motors));
+
+    // Lines are only segmented when the kinematics are not linear, arcs always are
+    KinematicsPlanner corexy_planner(corexy, {0, 0, 0});
+    corexy_planner.line_to({30, 10, 0});
+    assert(corexy_planner.getToolpath().size() == 2);
+    KinematicsPlanner delta_planner(delta, {0, 0, 0});
+    delta_planner.setSegmentLength(2);
+    delta_planner.line_to({10, 0, 0});
+    delta_planner.arc_to({-10, 0, 0}, 0, 0, false);
+    const ToolpathColumns &toolpath = delta_planner.getToolpath();
+    assert(toolpath.size() == 1 + 5 + 16);
+    for (size_t i = 6; i < toolpath.size(); ++i) {
+        assert(is_equal(std::hypot(toolpath.x[i], toolpath.y[i]), 10, 1e-4) and toolpath.y[i] >= -1e-4);
+    }
+    assert(toolpath.x.back() == -10 and toolpath.y.back() == 0);
+
+    // Batch transform of a million point path
+    KinematicsPlanner long_path(delta, {50, 0, 0});
+    long_path.setSegmentLength(0.0003f);
+    long_path.arc_to({50, 0, 0}, 0, 0, true);
+    long_path.line_to({50, 0, 20});
+    assert(long_path.getToolpath().size() > 1000000);
+    MotorColumns heights;
+    assert(long_path.transform(heights));
+    assert(heights.size() == long_path.getToolpath().size());
+    assert(delta.inverse({50, 0, 0}, motors) and heights.motor[0].front() == motors[0]);
+    assert(delta.inverse({50, 0, 20}, motors) and heights.motor[1].back() == motors[1]);
+
+    // The motors of a segment share the same profile scaled by their distance and finish together
+    std::vector<MotorMove> moves;
+    std::vector<MotorLimits> limits = {{10, 5}, {10, 5}, {10, 5}};
+    assert(!corexy_planner.plan_moves({{10, 5}}, moves));
+    assert(corexy_planner.plan_moves(limits, moves) and moves.size() == 3);
+    assert(moves[0].distance == 40 and moves[0].direction == 1 and moves[1].distance == 20);
+    assert(moves[2].direction == 0 and KinematicsPlanner::make_controller(moves[2]) == nullptr);
+    assert(moves[0].max_velocity == 10 and moves[1].max_velocity == 5 and is_equal(moves[0].duration, 6));
+
+    assert(KinematicsPlanner::make_controller(moves[0])->getGoalPosition() == 40);
+    ControllerBatch<StepperController> batch;
+    StepperController &motor_a = batch.emplace<StepperController>(0, 0);
+    StepperController &motor_b = batch.emplace<StepperController>(0, 0);
+    for (size_t i = 0; i < 2; ++i) {
+        StepperController &motor = i == 0 ? motor_a : motor_b;
+        motor.set_goal(moves[i].distance, moves[i].max_velocity, moves[i].max_acceleration);
+        motor.setTrajectoryFilePath("");
+    }
+    assert(batch.begin_all() == 2);
+    while (batch.tick_all() == 2) {
+        assert(is_equal(motor_a.getCurrentPosition(), 2 * motor_b.getCurrentPosition(), 1e-3));
+    }
+    assert(batch.tick_all() == 0);
+    assert(is_equal(motor_a.getTimeElapsed(), moves[0].duration, 1e-3));
+    assert(motor_a.getCurrentPosition() == 40 and motor_b.getCurrentPosition() == 20);
+}
+
+void test_session_journal() {
+    const std::string path = "/tmp/stepper_session_test.smjr";
+    size_t ticks = 0;
+    {
+        StepperController sc(0, 0);
+        sc.setTrajectoryFilePath("");
+        JournalingController journal(sc, path);
+        assert(journal.isOpen());
+        journal.set_goal(100, 10, 1);
+        journal.step();
+        // 200 time steps plus the tick that finds the move over
+        ticks += 201;
+
+        // Adaptive move stopped half way through, the stop lands on the same tick in the replay
+        sc.setSamplingMode(SAMPLING_ADAPTIVE);
+        journal.set_goal(300, 20, 2);
+        assert(journal.begin_move());
+        for (int i = 0; i < 10; ++i) {
+            assert(journal.tick());
+        }
+        journal.request_stop();
+        ticks += 10;
+        while (journal.tick()) {
+            ++ticks;
+        }
+        ++ticks;
+        journal.finish_move();
+        assert(journal.isMoveCancelled() and sc.getCurrentPosition() < 300);
+
+        // Rejected moves are part of the session too
+        journal.set_goal(0, 10, 1);
+        journal.step();
+    }
+
+    JournalReplayer replayer(path);
+    assert(replayer.isOpen());
+    assert(replayer.getRecord(0).type == JOURNAL_SET_GOAL);
+    JournalReplayResult result = replayer.replay(false);
+    assert(result.mismatches == 0 and result.first_mismatch == replayer.getRecordCount());
+    assert(result.moves == 2 and result.ticks == ticks);
+
+    result = replayer.replay(true);
+    assert(result.mismatches == 0 and result.replay_duration >= result.recorded_duration);
+
+    // A single bit of difference in a recorded sample is reported
+    FILE *file = fopen(path.c_str(), "r+b");
+    long offset = sizeof(JournalHeader) + 10 * sizeof(JournalRecord) + offsetof(JournalRecord, values);
+    fseek(file, offset, SEEK_SET);
+    float position;
+    assert(fread(&position, sizeof(position), 1, file) == 1);
+    uint32_t bits;
+    memcpy(&bits, &position, sizeof(bits));
+    bits ^= 1u;
+    memcpy(&position, &bits, sizeof(bits));
+    fseek(file, offset, SEEK_SET);
+    fwrite(&position, sizeof(position), 1, file);
+    fclose(file);
+    JournalReplayer tampered(path);
+    assert(tampered.getRecord(10).type == JOURNAL_TICK);
+    result = tampered.replay(false);
+    assert(result.mismatches == 1 and result.first_mismatch == 10);
+    remove(path.c_str());
+}
+
 void run_all_tests() {
     test_getCurrentPosition();
     test_getCurrentVelocity();
     test_pre_motion_sanity_checks();
+    test_trajectory_archive();
+    test_move_executor();
+    test_controller_batch();
+    test_exact_goal_landing();
+    test_adaptive_sampling();
+    test_shared_memory_telemetry();
+    test_logger();
+    test_kinematics();
+    test_session_journal();
     test_step();
 }
 